@@ -0,0 +1,77 @@
+#pragma once
+
+// Integer fixed-point helpers shared by twl.waxpayio, swl.waxpayio and waxpayio.
+//
+// Fees and slippage are stored in basis points (1 bps = 0.01%, 10000 bps = 100%)
+// and USD values in units of 10^-8 USD. Splits are computed with 128-bit
+// intermediates and rounded down, so every node computes the same amounts and
+// nothing is lost to floating point rounding.
+
+#include <cstdint>
+
+namespace fixed_point {
+
+    // 128-bit intermediate; the CDT's uint128 typedef comes from the eosio headers
+    using uint128 = unsigned __int128;
+
+    // 100% in basis points
+    constexpr uint32_t BPS_DENOMINATOR = 10000;
+
+    // One USD in usd_value units
+    constexpr uint64_t USD_DENOMINATOR = 100000000;
+
+    // Fee part of an order amount. The payer sends the base price plus
+    // fee_bps and slippage_bps on top of it, so the fee is
+    // amount * fee / (100% + fee + slippage), rounded down.
+    inline int64_t fee_amount(int64_t amount, uint32_t fee_bps, uint32_t slippage_bps)
+    {
+        uint128 denominator = uint128(BPS_DENOMINATOR) + fee_bps + slippage_bps;
+        return int64_t((uint128(amount) * fee_bps) / denominator);
+    }
+
+    // weight / total_weight of an amount, rounded down
+    inline int64_t weighted_share(int64_t amount, uint64_t weight, uint64_t total_weight)
+    {
+        return int64_t((uint128(amount) * weight) / total_weight);
+    }
+
+    // Exact split of an amount by weights in one pass. Each call returns the next
+    // part: the rounded-down share of the cumulative weight so far, minus what the
+    // earlier parts already took. Every part is within one unit of its exact share
+    // and the parts always add up to the amount, so nothing is left over.
+    struct weighted_splitter
+    {
+        int64_t amount;
+        uint64_t total_weight;
+        uint64_t cumulative_weight = 0;
+        int64_t spent = 0;
+
+        int64_t next(uint64_t weight)
+        {
+            cumulative_weight += weight;
+            int64_t upto = weighted_share(amount, cumulative_weight, total_weight);
+            int64_t part = upto - spent;
+            spent = upto;
+            return part;
+        }
+    };
+
+    // Clamp a basis point value into [min_bps, max_bps]
+    inline uint32_t clamp_bps(uint32_t value, uint32_t min_bps, uint32_t max_bps)
+    {
+        return value < min_bps ? min_bps : (value > max_bps ? max_bps : value);
+    }
+
+    // Legacy double percentage (1.5 = 1.5%) to basis points, used by migrations
+    inline uint32_t percent_to_bps(double percent)
+    {
+        return percent <= 0 ? 0 : uint32_t(percent * 100 + 0.5);
+    }
+
+    // Legacy double USD value to usd_value units, used by migrations
+    inline uint64_t usd_to_fixed(double usd)
+    {
+        return usd <= 0 ? 0 : uint64_t(usd * USD_DENOMINATOR + 0.5);
+    }
+
+} // namespace fixed_point
@@ -0,0 +1,349 @@
+#!/usr/bin/env python3
+"""End-to-end load test of the contracts on a throwaway local chain.
+
+Starts keosd and a single-producer nodeos in a temporary directory, activates
+the protocol features the contracts need through eosio.boot, builds the three
+contracts from source with cdt-cpp (or eosio-cpp), deploys them with
+eosio.token, pushes a payment workload through
+cleos, and prints billed CPU/NET percentiles per action and the final RAM
+usage of every contract account. Only local processes are used.
+
+    loadtest/loadgen.py --token-dir <dir with eosio.token.wasm/.abi> \
+                        --boot-dir <dir with eosio.boot.wasm/.abi>
+
+The same --seed gives the same workload.
+"""
+import argparse
+import json
+import os
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.request
+from collections import defaultdict
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+CONTRACTS = ["twl.waxpayio", "swl.waxpayio", "waxpayio"]
+
+# Well-known development key, only ever used on the throwaway chain
+DEV_PRIVATE_KEY = "5KQwrPbwdL6PhXujxW37FSSQZ1JiwsST4cqQzDeyXtP79zkvFD3"
+DEV_PUBLIC_KEY = "EOS6MRyAjQq8ud7hVNYcfnVPJqcVpscN5So8BhtHuGYqET5GDW5CV"
+
+# Protocol feature digests. PREACTIVATE_FEATURE is scheduled through the
+# producer API; the others are activated with eosio.boot's activate action.
+PREACTIVATE_FEATURE = "0ec7e080177b2c02b278d5088611686b49d739925a92d9bfcacd7fc6b74053bd"
+FEATURES = {
+    "ACTION_RETURN_VALUE": "c3a6138c5061cf291310887c0b5c71fcaffeab90d5deb50d3b9e687cead45071",
+    "WTMSIG_BLOCK_SIGNATURES": "299dcb6af692324b899b39f16d5a530a33062804e41f09dc97e9f156b4476707",
+    "GET_SENDER": "f0af56d2c5a48d60a4a5b5c903edfb7db3a736a94ed589d0b797df33ff9d3e1d",
+}
+
+SYMBOL = "8,WAX"
+SYSTEM_FEE_BPS = 100
+
+
+def account(prefix, i):
+    """Distinct account names: prefix followed by i in base 26 (letters only)."""
+    suffix = ""
+    for _ in range(4):
+        suffix += chr(ord("a") + i % 26)
+        i //= 26
+    return prefix + suffix
+
+
+def wax(amount):
+    return "%d.%08d WAX" % (amount // 10**8, amount % 10**8)
+
+
+class Chain:
+    """keosd and nodeos processes plus a cleos wrapper."""
+
+    def __init__(self, workdir, port, tools):
+        self.workdir = workdir
+        self.node_url = "http://127.0.0.1:%d" % port
+        self.wallet_url = "http://127.0.0.1:%d" % (port + 1)
+        self.tools = tools
+        self.processes = []
+
+    def start(self):
+        log = open(os.path.join(self.workdir, "keosd.log"), "w")
+        self.processes.append(subprocess.Popen([
+            self.tools["keosd"],
+            "--wallet-dir", os.path.join(self.workdir, "wallet"),
+            "--http-server-address", self.wallet_url[len("http://"):],
+            "--unlock-timeout", "999999",
+        ], stdout=log, stderr=subprocess.STDOUT))
+
+        log = open(os.path.join(self.workdir, "nodeos.log"), "w")
+        self.processes.append(subprocess.Popen([
+            self.tools["nodeos"], "-e", "-p", "eosio",
+            "--data-dir", os.path.join(self.workdir, "data"),
+            "--config-dir", os.path.join(self.workdir, "config"),
+            "--plugin", "eosio::producer_plugin",
+            "--plugin", "eosio::chain_api_plugin",
+            "--plugin", "eosio::producer_api_plugin",
+            "--plugin", "eosio::http_plugin",
+            "--http-server-address", self.node_url[len("http://"):],
+            "--http-validate-host", "false",
+            "--chain-state-db-size-mb", "4096",
+            "--max-transaction-time", "1000",
+            "--abi-serializer-max-time-ms", "1000",
+            "--signature-provider", DEV_PUBLIC_KEY + "=KEY:" + DEV_PRIVATE_KEY,
+        ], stdout=log, stderr=subprocess.STDOUT))
+
+        for _ in range(100):
+            if self.try_cleos("get", "info") is not None:
+                break
+            time.sleep(0.2)
+        else:
+            sys.exit("nodeos did not start, see " + os.path.join(self.workdir, "nodeos.log"))
+
+        self.cleos("wallet", "create", "--to-console")
+        self.cleos("wallet", "import", "--private-key", DEV_PRIVATE_KEY)
+
+    def boot(self, boot_dir):
+        """Activates PREACTIVATE_FEATURE, deploys eosio.boot and activates FEATURES.
+        Each step takes effect in the next block."""
+        request = urllib.request.Request(
+            self.node_url + "/v1/producer/schedule_protocol_feature_activations",
+            data=json.dumps({"protocol_features_to_activate": [PREACTIVATE_FEATURE]}).encode(),
+            headers={"Content-Type": "application/json"})
+        urllib.request.urlopen(request).read()
+        self.wait_blocks(2)
+        self.deploy("eosio", os.path.join(boot_dir, "eosio.boot.wasm"),
+                    os.path.join(boot_dir, "eosio.boot.abi"))
+        for digest in FEATURES.values():
+            self.cleos("push", "action", "eosio", "activate", json.dumps([digest]), "-p", "eosio@active")
+        self.wait_blocks(2)
+
+    def wait_blocks(self, count):
+        head = json.loads(self.cleos("get", "info"))["head_block_num"]
+        while json.loads(self.cleos("get", "info"))["head_block_num"] < head + count:
+            time.sleep(0.1)
+
+    def stop(self):
+        for process in reversed(self.processes):
+            process.terminate()
+            process.wait()
+
+    def run_cleos(self, *args):
+        command = [self.tools["cleos"], "-u", self.node_url, "--wallet-url", self.wallet_url] + list(args)
+        return subprocess.run(command, capture_output=True, text=True)
+
+    def try_cleos(self, *args):
+        result = self.run_cleos(*args)
+        return result.stdout if result.returncode == 0 else None
+
+    def cleos(self, *args):
+        result = self.run_cleos(*args)
+        if result.returncode != 0:
+            sys.exit("cleos %s failed:\n%s" % (" ".join(args), result.stderr))
+        return result.stdout
+
+    def create_account(self, name):
+        self.cleos("create", "account", "eosio", name, DEV_PUBLIC_KEY)
+
+    def deploy(self, name, wasm, abi):
+        self.cleos("set", "contract", name, os.path.dirname(wasm), os.path.basename(wasm), os.path.basename(abi))
+
+    def add_code_permission(self, name):
+        self.cleos("set", "account", "permission", name, "active", "--add-code")
+
+    def push(self, contract, action, data, actor):
+        """Pushes one action in its own transaction. Returns the processed
+        transaction, or None if the chain rejected it."""
+        result = self.run_cleos("push", "action", contract, action, json.dumps(data),
+                                "-p", actor + "@active", "-j", "-f")
+        if result.returncode != 0:
+            return None
+        return json.loads(result.stdout)["processed"]
+
+    def ram_usage(self, name):
+        return json.loads(self.cleos("get", "account", name, "-j"))["ram_usage"]
+
+
+def find_tools():
+    tools = {}
+    for tool in ["nodeos", "keosd", "cleos"]:
+        tools[tool] = shutil.which(tool)
+        if tools[tool] is None:
+            sys.exit(tool + " not found in PATH")
+    return tools
+
+
+def contract_files(workdir):
+    """(wasm, abi) per contract, built from source with the CDT."""
+    files = {}
+    compiler = shutil.which("cdt-cpp") or shutil.which("eosio-cpp")
+    if compiler is None:
+        sys.exit("cdt-cpp/eosio-cpp not found in PATH")
+    for contract in CONTRACTS:
+        source_dir = os.path.join(ROOT, contract)
+        out_dir = os.path.join(workdir, "build", contract)
+        os.makedirs(out_dir)
+        wasm = os.path.join(out_dir, contract + ".wasm")
+        subprocess.run([compiler, "-abigen", "-o", wasm, os.path.join(source_dir, contract + ".cpp")],
+                       check=True)
+        files[contract] = (wasm, os.path.join(out_dir, contract + ".abi"))
+    return files
+
+
+class Stats:
+    """Billed CPU (us) and NET (bytes) per action type."""
+
+    def __init__(self):
+        self.cpu = defaultdict(list)
+        self.net = defaultdict(list)
+        self.failures = defaultdict(int)
+
+    def record(self, label, processed):
+        if processed is None:
+            self.failures[label] += 1
+            return
+        receipt = processed["receipt"]
+        self.cpu[label].append(receipt["cpu_usage_us"])
+        self.net[label].append(receipt["net_usage_words"] * 8)
+
+    def report(self):
+        def percentile(values, p):
+            values = sorted(values)
+            return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+        print("%-14s %7s %7s %7s %7s %7s %7s %9s" %
+              ("action", "count", "failed", "cpu p50", "cpu p90", "cpu p99", "cpu max", "net avg"))
+        for label in sorted(set(self.cpu) | set(self.failures)):
+            cpu = self.cpu[label]
+            if not cpu:
+                print("%-14s %7d %7d" % (label, 0, self.failures[label]))
+                continue
+            print("%-14s %7d %7d %7d %7d %7d %7d %9.1f" % (
+                label, len(cpu), self.failures[label],
+                percentile(cpu, 50), percentile(cpu, 90), percentile(cpu, 99), max(cpu),
+                sum(self.net[label]) / len(self.net[label])))
+
+
+def setup(chain, args, files):
+    for name in ["eosio.token", "fee.waxpayio"] + CONTRACTS:
+        chain.create_account(name)
+    chain.deploy("eosio.token", os.path.join(args.token_dir, "eosio.token.wasm"),
+                 os.path.join(args.token_dir, "eosio.token.abi"))
+    for contract in CONTRACTS:
+        chain.deploy(contract, *files[contract])
+    for contract in CONTRACTS:
+        chain.add_code_permission(contract)
+
+    chain.cleos("push", "action", "eosio.token", "create",
+                json.dumps(["eosio.token", wax(10**17)]), "-p", "eosio.token@active")
+    chain.cleos("push", "action", "eosio.token", "issue",
+                json.dumps(["eosio.token", wax(10**17), ""]), "-p", "eosio.token@active")
+    chain.cleos("push", "action", "twl.waxpayio", "addtoken",
+                json.dumps(["eosio.token", SYMBOL, "", SYSTEM_FEE_BPS]), "-p", "twl.waxpayio@active")
+
+    recipients = [account("rcpt", i) for i in range(args.recipients)]
+    payers = [account("payr", i) for i in range(args.payers)]
+    for name in recipients + payers:
+        chain.create_account(name)
+    for payer in payers:
+        chain.cleos("push", "action", "eosio.token", "transfer",
+                    json.dumps(["eosio.token", payer, wax(10**15), ""]), "-p", "eosio.token@active")
+
+    # Store ids are assigned in order, starting at 0
+    stores = []
+    for i in range(args.stores):
+        owner = account("shop", i)
+        chain.create_account(owner)
+        chain.cleos("push", "action", "swl.waxpayio", "addstore",
+                    json.dumps([owner, "Store %d" % i, owner]), "-p", "swl.waxpayio@active")
+        for weight, recipient in enumerate(recipients, start=1):
+            chain.cleos("push", "action", "swl.waxpayio", "addrecipient",
+                        json.dumps([owner, recipient, weight]), "-p", owner + "@active")
+        chain.cleos("push", "action", "swl.waxpayio", "addtoken",
+                    json.dumps([owner, 0, 0, 10000, 0]), "-p", owner + "@active")
+        stores.append(i)
+        if (i + 1) % 50 == 0:
+            print("  %d stores ready" % (i + 1), flush=True)
+    return stores, payers
+
+
+def workload(chain, args, stores, payers, stats):
+    """Payments to random stores. Once more than --backlog orders are pending,
+    each payment is followed by an accept or reject of a random pending order.
+    Payers claim their refunds every --claim-every payments and at the end."""
+    rng = random.Random(args.seed)
+    pending = []
+    for i in range(args.payments):
+        store = rng.choice(stores)
+        payer = rng.choice(payers)
+        memo = "%d:%s-%d" % (store, args.seed, i)
+        amount = rng.randint(10**6, 10**10)
+        processed = chain.push("eosio.token", "transfer", [payer, "waxpayio", wax(amount), memo], payer)
+        stats.record("payment", processed)
+        if processed is not None:
+            pending.append((memo, store))
+
+        if len(pending) > args.backlog:
+            memo, store = pending.pop(rng.randrange(len(pending)))
+            if rng.random() < args.reject_ratio:
+                stats.record("rejectorder", chain.push("waxpayio", "rejectorder", [memo], "waxpayio"))
+            else:
+                stats.record("acceptorder", chain.push("waxpayio", "acceptorder",
+                                                       [memo, store, "thanks"], "waxpayio"))
+
+        if (i + 1) % args.claim_every == 0:
+            payer = rng.choice(payers)
+            stats.record("claim", chain.push("waxpayio", "claim", [payer, 10], payer))
+        if (i + 1) % 500 == 0:
+            print("  %d payments" % (i + 1), flush=True)
+
+    for payer in payers:
+        stats.record("claim", chain.push("waxpayio", "claim", [payer, 10], payer))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--token-dir", required=True, help="directory with eosio.token.wasm and eosio.token.abi")
+    parser.add_argument("--boot-dir", required=True, help="directory with eosio.boot.wasm and eosio.boot.abi")
+    parser.add_argument("--stores", type=int, default=500)
+    parser.add_argument("--recipients", type=int, default=3, help="recipients per store")
+    parser.add_argument("--payers", type=int, default=20)
+    parser.add_argument("--payments", type=int, default=10000)
+    parser.add_argument("--backlog", type=int, default=200, help="pending orders kept before accepting/rejecting")
+    parser.add_argument("--reject-ratio", type=float, default=0.2)
+    parser.add_argument("--claim-every", type=int, default=100)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--port", type=int, default=18888, help="nodeos HTTP port; keosd uses the next one")
+    parser.add_argument("--keep", action="store_true", help="keep the chain's working directory")
+    args = parser.parse_args()
+
+    tools = find_tools()
+    workdir = tempfile.mkdtemp(prefix="waxpay-load-")
+    files = contract_files(workdir)
+    chain = Chain(workdir, args.port, tools)
+    try:
+        chain.start()
+        chain.boot(args.boot_dir)
+        print("Setting up %d stores" % args.stores, flush=True)
+        stores, payers = setup(chain, args, files)
+        stats = Stats()
+        print("Running %d payments" % args.payments, flush=True)
+        workload(chain, args, stores, payers, stats)
+
+        print()
+        stats.report()
+        print()
+        print("%-14s %10s" % ("account", "ram bytes"))
+        for name in ["eosio.token"] + CONTRACTS:
+            print("%-14s %10d" % (name, chain.ram_usage(name)))
+    finally:
+        chain.stop()
+        if args.keep:
+            print("Chain data kept in " + workdir)
+        else:
+            shutil.rmtree(workdir, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
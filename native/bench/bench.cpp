@@ -0,0 +1,216 @@
+// Scaling benchmarks for the hot actions. Each scenario grows one dimension
+// (pending orders, whitelisted tokens, stores, recipients per store, stores
+// holding a removed token) and reports per-action DB reads/writes, inline
+// actions, heap allocations and wall time on the in-memory chain. Allocations
+// include the harness's own but, unlike wall time, don't vary between runs, so
+// they show copies added to or removed from the contracts.
+//
+//   waxpay_bench            full sweep
+//   waxpay_bench --quick    smallest size of each scenario (used by ctest)
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <vector>
+
+#include "fixture.hpp"
+
+using namespace waxpay_native;
+
+static uint64_t allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+struct measurement {
+    double reads = 0;
+    double writes = 0;
+    double inlines = 0;
+    double allocs = 0;
+    double micros = 0;
+};
+
+// Runs `op(i)` for i in [0, runs) and averages the counters and time per call
+measurement measure(uint32_t runs, const std::function<bool(uint32_t)>& op) {
+    auto& chain = eosio::native::chain::get();
+    auto before = chain.counters;
+    uint64_t allocs_before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < runs; i++) {
+        CHECK(op(i));
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    auto diff = chain.counters - before;
+    uint64_t allocs = allocations - allocs_before;
+
+    measurement m;
+    m.reads = double(diff.db_reads) / runs;
+    m.writes = double(diff.db_writes) / runs;
+    m.inlines = double(diff.inline_actions) / runs;
+    m.allocs = double(allocs) / runs;
+    m.micros = std::chrono::duration<double, std::micro>(elapsed).count() / runs;
+    return m;
+}
+
+void report(const char* scenario, uint32_t size, const char* action, const measurement& m) {
+    std::printf("%-11s %7u  %-14s %9.1f %9.1f %7.1f %8.1f %11.2f\n",
+                scenario, size, action, m.reads, m.writes, m.inlines, m.allocs, m.micros);
+}
+
+// Fresh chain with WAX whitelisted at a 1% fee
+uint64_t start_chain() {
+    eosio::native::chain::reset();
+    deploy();
+    return add_token(WAX, 100);
+}
+
+// Memos the size merchant backends send (40-70 characters), so string copies
+// cost what they cost in production instead of fitting the small string buffer
+std::string order_memo(uint64_t store, const char* tag, uint32_t i) {
+    char id[64];
+    std::snprintf(id, sizeof(id), "%s-%08u-4c1e-9a7b-2f6d0e8c3b5a-checkout", tag, i);
+    return std::to_string(store) + ":" + id;
+}
+
+const std::string ACCEPT_MEMO = "WaxPay order settlement, thank you for your purchase";
+
+// Pending orders already in the store's scope
+void orders_scenario(uint32_t count) {
+    uint64_t token_id = start_chain();
+    name owner = account("shop", 0);
+    uint64_t store = add_store(owner, 2);
+    accept_token(owner, token_id);
+    for (uint32_t i = 0; i < count; i++) {
+        CHECK(pay(asset(101000000, WAX), order_memo(store, "pending", i)));
+    }
+
+    const uint32_t runs = 100;
+    report("orders", count, "orderpaid", measure(runs, [&](uint32_t i) {
+        return pay(asset(101000000, WAX), order_memo(store, "new", i));
+    }));
+    report("orders", count, "acceptorder", measure(runs, [&](uint32_t i) {
+        return push(WAXPAY, WAXPAY, "acceptorder"_n, order_memo(store, "new", i), store, ACCEPT_MEMO);
+    }));
+    report("orders", count, "rejectorder", measure(runs, [&](uint32_t i) {
+        return push(WAXPAY, WAXPAY, "rejectorder"_n, order_memo(store, "pending", i));
+    }));
+    for (uint32_t i = 0; i < 50; i++) {
+        CHECK(pay(asset(101000000, WAX), order_memo(store, "stale", i)));
+    }
+    CHECK(push(WAXPAY, WAXPAY, "setttl"_n, uint32_t(1)));
+    eosio::native::chain::get().advance(eosio::seconds(10));
+    report("orders", count, "expire(50)", measure(1, [&](uint32_t) {
+        return push(PAYER, WAXPAY, "expire"_n, store, uint32_t(50));
+    }));
+}
+
+// Whitelisted tokens; the store accepts the last one added
+void tokens_scenario(uint32_t count) {
+    start_chain();
+    uint64_t token_id = 0;
+    symbol sym;
+    for (uint32_t i = 0; i < count; i++) {
+        sym = token_symbol(i);
+        token_id = add_token(sym, 100);
+    }
+    name owner = account("shop", 0);
+    uint64_t store = add_store(owner, 2);
+    accept_token(owner, token_id);
+
+    const uint32_t runs = 100;
+    report("tokens", count, "orderpaid", measure(runs, [&](uint32_t i) {
+        return pay(asset(1010000, sym), order_memo(store, "o", i));
+    }));
+    report("tokens", count, "acceptorder", measure(runs, [&](uint32_t i) {
+        return push(WAXPAY, WAXPAY, "acceptorder"_n, order_memo(store, "o", i), store, ACCEPT_MEMO);
+    }));
+    report("tokens", count, "quote", measure(runs, [&](uint32_t) {
+        return push(PAYER, WAXPAY, "quote"_n, store, token_id, int64_t(1010000));
+    }));
+}
+
+// Registered stores; store-owner actions find their store through check_authorized
+void stores_scenario(uint32_t count) {
+    uint64_t token_id = start_chain();
+    name owner;
+    for (uint32_t i = 0; i < count; i++) {
+        owner = account("shop", i);
+        add_store(owner, 1);
+    }
+    accept_token(owner, token_id);
+
+    const uint32_t runs = 100;
+    report("stores", count, "addstore", measure(runs, [&](uint32_t i) {
+        name next = account("next", i);
+        return push(SWL, SWL, "addstore"_n, next.to_string(), std::string("Store"), next);
+    }));
+    report("stores", count, "setpullmode", measure(runs, [&](uint32_t i) {
+        return push(owner, SWL, "setpullmode"_n, owner, i % 2 == 0);
+    }));
+    report("stores", count, "changestate", measure(runs, [&](uint32_t i) {
+        return push(owner, SWL, "changestate"_n, owner, token_id, i % 2 == 1);
+    }));
+}
+
+// Recipients of one store; every accepted order pays each of them
+void recipients_scenario(uint32_t count) {
+    uint64_t token_id = start_chain();
+    name owner = account("shop", 0);
+    uint64_t store = add_store(owner, count);
+    accept_token(owner, token_id);
+
+    const uint32_t runs = 100;
+    for (uint32_t i = 0; i < runs; i++) {
+        CHECK(pay(asset(101000000, WAX), order_memo(store, "o", i)));
+    }
+    report("recipients", count, "acceptorder", measure(runs, [&](uint32_t i) {
+        return push(WAXPAY, WAXPAY, "acceptorder"_n, order_memo(store, "o", i), store, ACCEPT_MEMO);
+    }));
+    report("recipients", count, "settle", measure(1, [&](uint32_t) {
+        return push(PAYER, WAXPAY, "settle"_n, store, token_id, uint32_t(20));
+    }));
+}
+
+// Stores accepting a token that twl removes; rmvsystoken only queues the sweep
+void sweep_scenario(uint32_t count) {
+    uint64_t token_id = start_chain();
+    for (uint32_t i = 0; i < count; i++) {
+        name owner = account("shop", i);
+        add_store(owner, 1);
+        accept_token(owner, token_id);
+    }
+
+    report("sweep", count, "rmtoken", measure(1, [&](uint32_t) {
+        return push(TWL, TWL, "rmtoken"_n, token_id);
+    }));
+    uint32_t calls = (count + 49) / 50;
+    report("sweep", count, "sweeptoken(50)", measure(calls, [&](uint32_t) {
+        return push(PAYER, SWL, "sweeptoken"_n, token_id, uint32_t(50));
+    }));
+    CHECK(console() == "Sweep done");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool quick = argc > 1 && std::strcmp(argv[1], "--quick") == 0;
+    auto sizes = [&](std::vector<uint32_t> all) {
+        return quick ? std::vector<uint32_t>{all.front()} : all;
+    };
+
+    std::printf("%-11s %7s  %-14s %9s %9s %7s %8s %11s\n",
+                "scenario", "size", "action", "db reads", "db writes", "inline", "allocs", "us/action");
+    for (auto n : sizes({100, 1000, 10000})) orders_scenario(n);
+    for (auto n : sizes({1, 10, 100, 1000})) tokens_scenario(n);
+    for (auto n : sizes({1, 10, 100, 1000})) stores_scenario(n);
+    for (auto n : sizes({1, 5, 10, 20})) recipients_scenario(n);
+    for (auto n : sizes({10, 100, 1000})) sweep_scenario(n);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+// Binds contract member functions to the in-memory chain's dispatcher.
+#include <tuple>
+#include <type_traits>
+
+#include <eosio/eosio.hpp>
+
+namespace waxpay_native {
+
+using eosio::name;
+
+template <typename C, typename R, typename... Args>
+eosio::native::chain::handler make_handler(R (C::*method)(Args...)) {
+    return [method](name receiver, name code, const std::string& data) {
+        auto args = eosio::unpack<std::tuple<std::decay_t<Args>...>>(data);
+        C obj(receiver, code, eosio::datastream<const char*>(data.data(), data.size()));
+        // Like the CDT dispatcher, a non-void action result becomes the action's return value
+        if constexpr (std::is_void_v<R>) {
+            std::apply([&](auto&... a) { (obj.*method)(a...); }, args);
+        } else {
+            R result = std::apply([&](auto&... a) { return (obj.*method)(a...); }, args);
+            eosio::native::chain::get().set_return_value(eosio::pack(result));
+        }
+    };
+}
+
+template <typename C, typename R, typename... Args>
+void bind_action(name account, name act, R (C::*method)(Args...)) {
+    eosio::native::chain::get().set_handler(account, act, make_handler(method));
+}
+
+template <typename C, typename R, typename... Args>
+void bind_notify(name account, name act, R (C::*method)(Args...)) {
+    eosio::native::chain::get().set_notify_handler(account, act, make_handler(method));
+}
+
+// Pushes `account::act(args...)` authorized by `actor`; returns false on failure.
+template <typename... Args>
+bool push(name actor, name account, name act, Args&&... args) {
+    eosio::native::action_data a{account, act, {{actor, name("active")}},
+                                 eosio::pack(std::make_tuple(std::forward<Args>(args)...))};
+    return eosio::native::chain::get().push(std::move(a));
+}
+
+// Runs `body` as if it executed inside `receiver`, for direct table inspection.
+template <typename F>
+auto as_contract(name receiver, F&& body) {
+    auto& c = eosio::native::chain::get();
+    auto saved = c.current_receiver;
+    c.current_receiver = receiver;
+    struct restore {
+        eosio::native::chain& c;
+        name saved;
+        ~restore() { c.current_receiver = saved; }
+    } r{c, saved};
+    return body();
+}
+
+} // namespace waxpay_native
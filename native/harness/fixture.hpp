@@ -0,0 +1,180 @@
+#pragma once
+// Compiles the three contracts natively and deploys them, with eosio.token, on
+// the in-memory chain. Include it once per test or benchmark executable.
+#include "../../twl.waxpayio/twl.waxpayio.cpp"
+#include "../../swl.waxpayio/swl.waxpayio.cpp"
+#include "../../waxpayio/waxpayio.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "dispatch.hpp"
+#include "token.hpp"
+
+// Fails the test executable with the location of the first broken expectation.
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed; last error: %s\n",    \
+                         __FILE__, __LINE__, #cond,                              \
+                         eosio::native::chain::get().last_error.c_str());        \
+            std::exit(1);                                                        \
+        }                                                                        \
+    } while (0)
+
+// The contracts' private tables, reachable through their friend declarations
+struct native_access {
+    using waxpay_orders_v1 = waxpay::orders_v1_table;
+    using waxpay_balances = waxpay::balances_table;
+    using waxpay_payouts = waxpay::payouts_table;
+    using waxpay_stats = waxpay::stats_table;
+    using twl_tokens = tokenwhitelist::tokens_table;
+    using twl_tokens_v1 = tokenwhitelist::tokens_v1_table;
+    using twl_tokenmeta = tokenwhitelist::tokenmeta_table;
+    using swl_stores = storewhitelist::stores_table;
+    using swl_tokens = storewhitelist::tokens_table;
+    using swl_tokens_v1 = storewhitelist::tokens_v1_table;
+    using swl_recipients = storewhitelist::recipients_table;
+    using swl_recipients_v1 = storewhitelist::recipients_v1_table;
+};
+
+namespace waxpay_native {
+
+constexpr name TOKEN = "eosio.token"_n;
+constexpr name TWL = "twl.waxpayio"_n;
+constexpr name SWL = "swl.waxpayio"_n;
+constexpr name WAXPAY = "waxpayio"_n;
+constexpr name PAYER = "alice"_n;
+
+inline const symbol WAX("WAX", 8);
+
+// Binds every action of eosio.token and the three contracts
+inline void deploy() {
+    for (auto n : {"alice"_n, "fee.waxpayio"_n}) eosio::native::chain::get().create_account(n);
+
+    bind_action(TOKEN, "create"_n, &token::create);
+    bind_action(TOKEN, "issue"_n, &token::issue);
+    bind_action(TOKEN, "transfer"_n, &token::transfer);
+
+    bind_action(TWL, "addtoken"_n, &tokenwhitelist::addtoken);
+    bind_action(TWL, "changesysfee"_n, &tokenwhitelist::changesysfee);
+    bind_action(TWL, "changeimage"_n, &tokenwhitelist::changeimage);
+    bind_action(TWL, "rmtoken"_n, &tokenwhitelist::rmtoken);
+    bind_action(TWL, "cls"_n, &tokenwhitelist::cls);
+    bind_action(TWL, "addslippage"_n, &tokenwhitelist::addslippage);
+    bind_action(TWL, "pushcfg"_n, &tokenwhitelist::pushcfg);
+    bind_action(TWL, "reindex"_n, &tokenwhitelist::reindex);
+    bind_action(TWL, "migrate"_n, &tokenwhitelist::migrate);
+
+    bind_action(SWL, "addstore"_n, &storewhitelist::addstore);
+    bind_action(SWL, "addrecipient"_n, &storewhitelist::addrecipient);
+    bind_action(SWL, "rmvrecs"_n, &storewhitelist::rmvrecs);
+    bind_action(SWL, "rmvrec"_n, &storewhitelist::rmvrec);
+    bind_action(SWL, "addtoken"_n, &storewhitelist::addtoken);
+    bind_action(SWL, "edittoken"_n, &storewhitelist::edittoken);
+    bind_action(SWL, "changestate"_n, &storewhitelist::changestate);
+    bind_action(SWL, "rmvtoken"_n, &storewhitelist::rmvtoken);
+    bind_action(SWL, "rmvsystoken"_n, &storewhitelist::rmvsystoken);
+    bind_action(SWL, "sweeptoken"_n, &storewhitelist::sweeptoken);
+    bind_action(SWL, "setpullmode"_n, &storewhitelist::setpullmode);
+    bind_action(SWL, "setautoacc"_n, &storewhitelist::setautoacc);
+    bind_action(SWL, "cls"_n, &storewhitelist::cls);
+    bind_action(SWL, "pushprofiles"_n, &storewhitelist::pushprofiles);
+    bind_action(SWL, "reindex"_n, &storewhitelist::reindex);
+    bind_action(SWL, "indextokens"_n, &storewhitelist::indextokens);
+    bind_action(SWL, "migraterecs"_n, &storewhitelist::migraterecs);
+    bind_action(SWL, "migrate"_n, &storewhitelist::migrate);
+
+    bind_notify(WAXPAY, "transfer"_n, &waxpay::orderpaid);
+    bind_action(WAXPAY, "acceptorder"_n, &waxpay::acceptorder);
+    bind_action(WAXPAY, "acceptorders"_n, &waxpay::acceptorders);
+    bind_action(WAXPAY, "rejectorder"_n, &waxpay::rejectorder);
+    bind_action(WAXPAY, "rejectorders"_n, &waxpay::rejectorders);
+    bind_action(WAXPAY, "orderfailed"_n, &waxpay::orderfailed);
+    bind_action(WAXPAY, "claim"_n, &waxpay::claim);
+    bind_action(WAXPAY, "withdraw"_n, &waxpay::withdraw);
+    bind_action(WAXPAY, "settle"_n, &waxpay::settle);
+    bind_action(WAXPAY, "settokencfg"_n, &waxpay::settokencfg);
+    bind_action(WAXPAY, "rmtokencfg"_n, &waxpay::rmtokencfg);
+    bind_action(WAXPAY, "setprofile"_n, &waxpay::setprofile);
+    bind_action(WAXPAY, "rmprofile"_n, &waxpay::rmprofile);
+    bind_action(WAXPAY, "cls"_n, &waxpay::cls);
+    bind_action(WAXPAY, "setttl"_n, &waxpay::setttl);
+    bind_action(WAXPAY, "expire"_n, &waxpay::expire);
+    bind_action(WAXPAY, "migrateords"_n, &waxpay::migrateords);
+    bind_action(WAXPAY, "quote"_n, &waxpay::quote);
+    bind_action(WAXPAY, "getorder"_n, &waxpay::getorder);
+    bind_action(WAXPAY, "getbalances"_n, &waxpay::getbalances);
+}
+
+// Distinct account names: prefix followed by i in base 26 (letters only)
+inline name account(const std::string& prefix, uint32_t i) {
+    std::string s = prefix;
+    for (int d = 0; d < 4; d++, i /= 26) s += char('a' + i % 26);
+    name n(s);
+    eosio::native::chain::get().create_account(n);
+    return n;
+}
+
+// Distinct token symbols with 4 decimals; index 0 is "TAAA"
+inline symbol token_symbol(uint32_t i) {
+    std::string code = "T";
+    for (int d = 0; d < 3; d++, i /= 26) code += char('A' + i % 26);
+    return symbol(code, 4);
+}
+
+// Creates `sym` on eosio.token, funds the payer with it and whitelists it.
+// Returns the twl token id.
+inline uint64_t add_token(symbol sym, uint32_t system_fee) {
+    bool ok = push(TOKEN, TOKEN, "create"_n, TOKEN, asset(1000000000000000000LL, sym));
+    ok &= push(TOKEN, TOKEN, "issue"_n, TOKEN, asset(1000000000000000LL, sym), std::string(""));
+    ok &= push(TOKEN, TOKEN, "transfer"_n, TOKEN, PAYER, asset(1000000000000000LL, sym), std::string(""));
+    ok &= push(TWL, TWL, "addtoken"_n, TOKEN, sym, std::string("https://example.com/token.png"), system_fee);
+    CHECK(ok);
+
+    waxpay::tokencfg_table tokens(WAXPAY, WAXPAY.value);
+    auto by_token = tokens.get_index<"bytoken"_n>();
+    return by_token.get((uint128_t(TOKEN.value) << 64) | sym.raw()).id;
+}
+
+// Registers a store owned by `owner` with `recipients` recipients of weight 1,
+// 2, 3, ... Returns the store's numeric id, the one used in memos.
+inline uint64_t add_store(name owner, uint32_t recipients) {
+    native_access::swl_stores stores(SWL, SWL.value);
+    uint64_t id = stores.available_primary_key();
+
+    CHECK(push(SWL, SWL, "addstore"_n, owner.to_string(), std::string("Store"), owner));
+    for (uint32_t i = 0; i < recipients; i++) {
+        CHECK(push(owner, SWL, "addrecipient"_n, owner, account("rcpt", i), uint32_t(i + 1)));
+    }
+    return id;
+}
+
+// Lets a store accept a whitelisted token with the full slippage range
+inline void accept_token(name owner, uint64_t token_id) {
+    CHECK(push(owner, SWL, "addtoken"_n, owner, token_id, uint32_t(0), fixed_point::BPS_DENOMINATOR, uint64_t(0)));
+}
+
+// The payer sends `quantity` to waxpayio with `memo`
+inline bool pay(asset quantity, const std::string& memo) {
+    return push(PAYER, TOKEN, "transfer"_n, PAYER, WAXPAY, quantity, memo);
+}
+
+inline int64_t balance(name owner, symbol sym) {
+    return token::get_balance(TOKEN, owner, sym.code());
+}
+
+// Console output of the first action of the last transaction
+inline std::string console() {
+    auto& traces = eosio::native::chain::get().traces;
+    return traces.empty() ? std::string() : traces.front().console;
+}
+
+// Return value of the last pushed read-only action
+template <typename T>
+T result() {
+    return eosio::unpack<T>(eosio::native::chain::get().traces.front().return_value);
+}
+
+} // namespace waxpay_native
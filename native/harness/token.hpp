@@ -0,0 +1,87 @@
+#pragma once
+// Minimal eosio.token used by the native harness: create/issue/transfer with
+// the standard `accounts` and `stat` table layouts.
+#include <eosio/asset.hpp>
+#include <eosio/eosio.hpp>
+
+namespace waxpay_native {
+
+using namespace eosio;
+
+class token : public contract {
+public:
+    using contract::contract;
+
+    void create(name issuer, asset maximum_supply) {
+        require_auth(get_self());
+        stats statstable(get_self(), maximum_supply.symbol.code().raw());
+        check(statstable.find(maximum_supply.symbol.code().raw()) == statstable.end(), "token with symbol already exists");
+        statstable.emplace(get_self(), [&](auto& s) {
+            s.supply.symbol = maximum_supply.symbol;
+            s.max_supply = maximum_supply;
+            s.issuer = issuer;
+        });
+    }
+
+    void issue(name to, asset quantity, std::string memo) {
+        stats statstable(get_self(), quantity.symbol.code().raw());
+        const auto& st = statstable.get(quantity.symbol.code().raw(), "token with symbol does not exist");
+        require_auth(st.issuer);
+        check(quantity.symbol == st.supply.symbol, "symbol precision mismatch");
+        statstable.modify(st, same_payer, [&](auto& s) { s.supply += quantity; });
+        add_balance(to, quantity, get_self());
+    }
+
+    void transfer(name from, name to, asset quantity, std::string memo) {
+        check(from != to, "cannot transfer to self");
+        require_auth(from);
+        check(is_account(to), "to account does not exist");
+        stats statstable(get_self(), quantity.symbol.code().raw());
+        const auto& st = statstable.get(quantity.symbol.code().raw(), "token with symbol does not exist");
+        check(quantity.amount > 0, "must transfer positive quantity");
+        check(quantity.symbol == st.supply.symbol, "symbol precision mismatch");
+        check(memo.size() <= 256, "memo has more than 256 bytes");
+        require_recipient(from);
+        require_recipient(to);
+        sub_balance(from, quantity);
+        add_balance(to, quantity, from);
+    }
+
+    static int64_t get_balance(name token_contract, name owner, symbol_code sym) {
+        accounts accountstable(token_contract, owner.value);
+        auto itr = accountstable.find(sym.raw());
+        return itr == accountstable.end() ? 0 : itr->balance.amount;
+    }
+
+    struct account {
+        asset balance;
+        uint64_t primary_key() const { return balance.symbol.code().raw(); }
+    };
+    struct currency_stats {
+        asset supply;
+        asset max_supply;
+        name issuer;
+        uint64_t primary_key() const { return supply.symbol.code().raw(); }
+    };
+    typedef multi_index<"accounts"_n, account> accounts;
+    typedef multi_index<"stat"_n, currency_stats> stats;
+
+private:
+    void sub_balance(name owner, asset value) {
+        accounts from_acnts(get_self(), owner.value);
+        const auto& from = from_acnts.get(value.symbol.code().raw(), "no balance object found");
+        check(from.balance.amount >= value.amount, "overdrawn balance");
+        from_acnts.modify(from, owner, [&](auto& a) { a.balance -= value; });
+    }
+    void add_balance(name owner, asset value, name ram_payer) {
+        accounts to_acnts(get_self(), owner.value);
+        auto to = to_acnts.find(value.symbol.code().raw());
+        if (to == to_acnts.end()) {
+            to_acnts.emplace(ram_payer, [&](auto& a) { a.balance = value; });
+        } else {
+            to_acnts.modify(to, same_payer, [&](auto& a) { a.balance += value; });
+        }
+    }
+};
+
+} // namespace waxpay_native
@@ -0,0 +1,41 @@
+#pragma once
+// Native stand-in for eosio::action and the authorization intrinsics.
+#include <vector>
+
+#include <eosio/datastream.hpp>
+#include <eosio/native.hpp>
+
+namespace eosio {
+
+inline void require_auth(name n) {
+    check(native::chain::get().has_auth(n), "missing authority of " + n.to_string());
+}
+inline bool has_auth(name n) { return native::chain::get().has_auth(n); }
+inline bool is_account(name n) { return native::chain::get().is_account(n); }
+inline void require_recipient(name n) { native::chain::get().require_recipient(n); }
+template <typename... Names>
+void require_recipient(name n, Names... rest) {
+    require_recipient(n);
+    require_recipient(rest...);
+}
+
+struct action {
+    name account;
+    name name_;
+    std::vector<permission_level> authorization;
+    std::string data;
+
+    action() = default;
+
+    template <typename T>
+    action(const permission_level& auth, name a, name n, T&& value)
+        : account(a), name_(n), authorization{auth}, data(pack(std::forward<T>(value))) {}
+
+    template <typename T>
+    action(std::vector<permission_level> auths, name a, name n, T&& value)
+        : account(a), name_(n), authorization(std::move(auths)), data(pack(std::forward<T>(value))) {}
+
+    void send() const { native::chain::get().send_inline({account, name_, authorization, data}); }
+};
+
+} // namespace eosio
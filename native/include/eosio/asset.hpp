@@ -0,0 +1,74 @@
+#pragma once
+// Native stand-in for eosio::asset.
+#include <cstdint>
+#include <string>
+
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+#include <eosio/symbol.hpp>
+
+namespace eosio {
+
+struct asset {
+    static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+    int64_t amount = 0;
+    eosio::symbol symbol;
+
+    asset() = default;
+    asset(int64_t a, eosio::symbol s) : amount(a), symbol(s) {
+        check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+        check(symbol.is_valid(), "invalid symbol name");
+    }
+
+    bool is_amount_within_range() const { return -max_amount <= amount && amount <= max_amount; }
+    bool is_valid() const { return is_amount_within_range() && symbol.is_valid(); }
+
+    asset operator-() const { return asset(-amount, symbol); }
+    asset& operator+=(const asset& a) {
+        check(a.symbol == symbol, "attempt to add asset with different symbol");
+        amount += a.amount;
+        check(-max_amount <= amount, "addition underflow");
+        check(amount <= max_amount, "addition overflow");
+        return *this;
+    }
+    asset& operator-=(const asset& a) {
+        check(a.symbol == symbol, "attempt to subtract asset with different symbol");
+        amount -= a.amount;
+        check(-max_amount <= amount, "subtraction underflow");
+        check(amount <= max_amount, "subtraction overflow");
+        return *this;
+    }
+    friend asset operator+(const asset& a, const asset& b) { asset r = a; r += b; return r; }
+    friend asset operator-(const asset& a, const asset& b) { asset r = a; r -= b; return r; }
+
+    std::string to_string() const {
+        std::string s;
+        int64_t p = symbol.precision();
+        int64_t a = amount < 0 ? -amount : amount;
+        std::string digits = std::to_string(a);
+        if (p > 0) {
+            while ((int64_t)digits.size() <= p) digits.insert(digits.begin(), '0');
+            digits.insert(digits.end() - p, '.');
+        }
+        if (amount < 0) s.push_back('-');
+        s += digits;
+        s += " " + symbol.code().to_string();
+        return s;
+    }
+
+    friend bool operator==(const asset& a, const asset& b) {
+        check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+        return a.amount == b.amount;
+    }
+    friend bool operator!=(const asset& a, const asset& b) { return !(a == b); }
+    friend bool operator<(const asset& a, const asset& b) {
+        check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+        return a.amount < b.amount;
+    }
+    friend bool operator<=(const asset& a, const asset& b) { return !(b < a); }
+    friend bool operator>(const asset& a, const asset& b) { return b < a; }
+    friend bool operator>=(const asset& a, const asset& b) { return !(a < b); }
+};
+
+} // namespace eosio
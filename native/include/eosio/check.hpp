@@ -0,0 +1,33 @@
+#pragma once
+// Native stand-in for eosio::check: a failed assertion throws, which the
+// harness turns into a transaction rollback.
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+typedef unsigned __int128 uint128_t;
+typedef __int128 int128_t;
+
+namespace eosio {
+
+struct eosio_assert_exception : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+constexpr inline void check(bool pred, const char* msg) {
+    if (!pred) throw eosio_assert_exception(msg);
+}
+inline void check(bool pred, const std::string& msg) {
+    if (!pred) throw eosio_assert_exception(msg);
+}
+inline void check(bool pred, std::string&& msg) {
+    if (!pred) throw eosio_assert_exception(msg);
+}
+inline void check(bool pred, const char* msg, std::size_t n) {
+    if (!pred) throw eosio_assert_exception(std::string(msg, n));
+}
+inline void check(bool pred, uint64_t code) {
+    if (!pred) throw eosio_assert_exception("error code " + std::to_string(code));
+}
+
+} // namespace eosio
@@ -0,0 +1,325 @@
+#pragma once
+// Native stand-in for eosio::datastream and the pack/unpack helpers.
+//
+// Aggregates (table rows, action argument tuples, mirror structs) are
+// serialized field by field in declaration order, the same way the CDT does
+// for reflected structs, so mirror definitions read another contract's rows
+// exactly as they would on chain.
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/name.hpp>
+#include <eosio/symbol.hpp>
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+template <typename T>
+class datastream {
+public:
+    datastream(T start, std::size_t s) : _start(start), _pos(start), _end(start + s) {}
+
+    void read(char* d, std::size_t s) {
+        check(std::size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+        std::memcpy(d, _pos, s);
+        _pos += s;
+    }
+    void write(const char* d, std::size_t s) {
+        check(std::size_t(_end - _pos) >= s, "datastream attempted to write past the end");
+        std::memcpy((void*)_pos, d, s);
+        _pos += s;
+    }
+    std::size_t remaining() const { return _end - _pos; }
+    std::size_t tellp() const { return _pos - _start; }
+    T pos() const { return _pos; }
+
+private:
+    T _start;
+    T _pos;
+    T _end;
+};
+
+namespace native_detail {
+
+// ---- aggregate field reflection ------------------------------------------
+
+struct any_field {
+    template <typename T>
+    constexpr operator T() const;
+};
+
+template <typename T, typename Seq, typename = void>
+struct brace_constructible : std::false_type {};
+template <typename T, std::size_t... I>
+struct brace_constructible<T, std::index_sequence<I...>,
+                           std::void_t<decltype(T{(void(I), any_field{})...})>> : std::true_type {};
+
+template <typename T, std::size_t N>
+constexpr std::size_t count_fields() {
+    if constexpr (N == 0) {
+        return 0;
+    } else if constexpr (brace_constructible<T, std::make_index_sequence<N>>::value) {
+        return N;
+    } else {
+        return count_fields<T, N - 1>();
+    }
+}
+
+template <typename T>
+constexpr std::size_t field_count = count_fields<std::remove_cv_t<T>, 20>();
+
+#define WAXPAY_NATIVE_TIE(N, ...)                         \
+    if constexpr (field_count<T> == N) {                  \
+        auto& [__VA_ARGS__] = obj;                        \
+        return std::forward_as_tuple(__VA_ARGS__);        \
+    } else
+
+template <typename T>
+auto tie_fields(T& obj) {
+    WAXPAY_NATIVE_TIE(1, a)
+    WAXPAY_NATIVE_TIE(2, a, b)
+    WAXPAY_NATIVE_TIE(3, a, b, c)
+    WAXPAY_NATIVE_TIE(4, a, b, c, d)
+    WAXPAY_NATIVE_TIE(5, a, b, c, d, e)
+    WAXPAY_NATIVE_TIE(6, a, b, c, d, e, f)
+    WAXPAY_NATIVE_TIE(7, a, b, c, d, e, f, g)
+    WAXPAY_NATIVE_TIE(8, a, b, c, d, e, f, g, h)
+    WAXPAY_NATIVE_TIE(9, a, b, c, d, e, f, g, h, i)
+    WAXPAY_NATIVE_TIE(10, a, b, c, d, e, f, g, h, i, j)
+    WAXPAY_NATIVE_TIE(11, a, b, c, d, e, f, g, h, i, j, k)
+    WAXPAY_NATIVE_TIE(12, a, b, c, d, e, f, g, h, i, j, k, l)
+    WAXPAY_NATIVE_TIE(13, a, b, c, d, e, f, g, h, i, j, k, l, m)
+    WAXPAY_NATIVE_TIE(14, a, b, c, d, e, f, g, h, i, j, k, l, m, n)
+    WAXPAY_NATIVE_TIE(15, a, b, c, d, e, f, g, h, i, j, k, l, m, n, o)
+    WAXPAY_NATIVE_TIE(16, a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p)
+    {
+        static_assert(field_count<T> <= 16, "too many fields for native reflection");
+        return std::tuple<>();
+    }
+}
+
+#undef WAXPAY_NATIVE_TIE
+
+template <typename T>
+struct is_std_vector : std::false_type {};
+template <typename T, typename A>
+struct is_std_vector<std::vector<T, A>> : std::true_type {};
+template <typename T>
+struct is_std_optional : std::false_type {};
+template <typename T>
+struct is_std_optional<std::optional<T>> : std::true_type {};
+template <typename T>
+struct is_std_tuple : std::false_type {};
+template <typename... T>
+struct is_std_tuple<std::tuple<T...>> : std::true_type {};
+template <typename T>
+struct is_std_pair : std::false_type {};
+template <typename A, typename B>
+struct is_std_pair<std::pair<A, B>> : std::true_type {};
+template <typename T>
+struct is_std_array : std::false_type {};
+template <typename T, std::size_t N>
+struct is_std_array<std::array<T, N>> : std::true_type {};
+template <typename T>
+struct is_std_map : std::false_type {};
+template <typename K, typename V, typename C, typename A>
+struct is_std_map<std::map<K, V, C, A>> : std::true_type {};
+
+} // namespace native_detail
+
+// ---- writer / reader ------------------------------------------------------
+
+struct pack_writer {
+    std::string out;
+    void raw(const void* p, std::size_t n) { out.append(static_cast<const char*>(p), n); }
+    void varuint(uint32_t v) {
+        do {
+            uint8_t b = v & 0x7f;
+            v >>= 7;
+            b |= (v > 0) << 7;
+            out.push_back(char(b));
+        } while (v);
+    }
+};
+
+struct pack_reader {
+    const char* pos;
+    const char* end;
+    void raw(void* p, std::size_t n) {
+        check(std::size_t(end - pos) >= n, "datastream attempted to read past the end");
+        std::memcpy(p, pos, n);
+        pos += n;
+    }
+    uint32_t varuint() {
+        uint64_t v = 0;
+        uint8_t b = 0;
+        int by = 0;
+        do {
+            raw(&b, 1);
+            v |= uint64_t(b & 0x7f) << by;
+            by += 7;
+        } while (b & 0x80);
+        return uint32_t(v);
+    }
+};
+
+template <typename T>
+void pack_value(pack_writer& w, const T& v);
+template <typename T>
+void unpack_value(pack_reader& r, T& v);
+
+template <typename T>
+void pack_value(pack_writer& w, const T& v) {
+    using namespace native_detail;
+    if constexpr (std::is_same_v<T, bool>) {
+        uint8_t b = v ? 1 : 0;
+        w.raw(&b, 1);
+    } else if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, uint128_t> || std::is_same_v<T, int128_t>) {
+        w.raw(&v, sizeof(T));
+    } else if constexpr (std::is_enum_v<T>) {
+        w.raw(&v, sizeof(T));
+    } else if constexpr (std::is_same_v<T, name>) {
+        w.raw(&v.value, 8);
+    } else if constexpr (std::is_same_v<T, symbol> || std::is_same_v<T, symbol_code>) {
+        uint64_t raw = v.raw();
+        w.raw(&raw, 8);
+    } else if constexpr (std::is_same_v<T, asset>) {
+        pack_value(w, v.amount);
+        pack_value(w, v.symbol);
+    } else if constexpr (std::is_same_v<T, time_point_sec>) {
+        pack_value(w, v.utc_seconds);
+    } else if constexpr (std::is_same_v<T, time_point>) {
+        pack_value(w, v.elapsed._count);
+    } else if constexpr (std::is_same_v<T, checksum256> || std::is_same_v<T, checksum160>) {
+        w.raw(v.data(), T::size());
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        w.varuint(uint32_t(v.size()));
+        w.raw(v.data(), v.size());
+    } else if constexpr (is_std_vector<T>::value) {
+        w.varuint(uint32_t(v.size()));
+        for (const auto& e : v) pack_value(w, e);
+    } else if constexpr (is_std_array<T>::value) {
+        for (const auto& e : v) pack_value(w, e);
+    } else if constexpr (is_std_map<T>::value) {
+        w.varuint(uint32_t(v.size()));
+        for (const auto& [k, val] : v) {
+            pack_value(w, k);
+            pack_value(w, val);
+        }
+    } else if constexpr (is_std_optional<T>::value) {
+        pack_value(w, bool(v));
+        if (v) pack_value(w, *v);
+    } else if constexpr (is_std_tuple<T>::value || is_std_pair<T>::value) {
+        std::apply([&](const auto&... e) { (pack_value(w, e), ...); }, v);
+    } else {
+        static_assert(std::is_aggregate_v<T>, "type is not serializable by the native harness");
+        auto fields = tie_fields(const_cast<T&>(v));
+        std::apply([&](const auto&... e) { (pack_value(w, e), ...); }, fields);
+    }
+}
+
+template <typename T>
+void unpack_value(pack_reader& r, T& v) {
+    using namespace native_detail;
+    if constexpr (std::is_same_v<T, bool>) {
+        uint8_t b;
+        r.raw(&b, 1);
+        v = b != 0;
+    } else if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, uint128_t> || std::is_same_v<T, int128_t>) {
+        r.raw(&v, sizeof(T));
+    } else if constexpr (std::is_enum_v<T>) {
+        r.raw(&v, sizeof(T));
+    } else if constexpr (std::is_same_v<T, name>) {
+        r.raw(&v.value, 8);
+    } else if constexpr (std::is_same_v<T, symbol> || std::is_same_v<T, symbol_code>) {
+        uint64_t raw;
+        r.raw(&raw, 8);
+        v = T(raw);
+    } else if constexpr (std::is_same_v<T, asset>) {
+        unpack_value(r, v.amount);
+        unpack_value(r, v.symbol);
+    } else if constexpr (std::is_same_v<T, time_point_sec>) {
+        unpack_value(r, v.utc_seconds);
+    } else if constexpr (std::is_same_v<T, time_point>) {
+        unpack_value(r, v.elapsed._count);
+    } else if constexpr (std::is_same_v<T, checksum256> || std::is_same_v<T, checksum160>) {
+        r.raw(v._data.data(), T::size());
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        uint32_t n = r.varuint();
+        check(std::size_t(r.end - r.pos) >= n, "datastream attempted to read past the end");
+        v.assign(r.pos, n);
+        r.pos += n;
+    } else if constexpr (is_std_vector<T>::value) {
+        uint32_t n = r.varuint();
+        v.clear();
+        v.resize(n);
+        for (auto& e : v) unpack_value(r, e);
+    } else if constexpr (is_std_array<T>::value) {
+        for (auto& e : v) unpack_value(r, e);
+    } else if constexpr (is_std_map<T>::value) {
+        uint32_t n = r.varuint();
+        v.clear();
+        for (uint32_t i = 0; i < n; ++i) {
+            typename T::key_type k;
+            typename T::mapped_type val;
+            unpack_value(r, k);
+            unpack_value(r, val);
+            v.emplace(std::move(k), std::move(val));
+        }
+    } else if constexpr (is_std_optional<T>::value) {
+        bool has;
+        unpack_value(r, has);
+        if (has) {
+            typename T::value_type e;
+            unpack_value(r, e);
+            v = std::move(e);
+        } else {
+            v.reset();
+        }
+    } else if constexpr (is_std_tuple<T>::value || is_std_pair<T>::value) {
+        std::apply([&](auto&... e) { (unpack_value(r, e), ...); }, v);
+    } else {
+        static_assert(std::is_aggregate_v<T>, "type is not deserializable by the native harness");
+        auto fields = tie_fields(v);
+        std::apply([&](auto&... e) { (unpack_value(r, e), ...); }, fields);
+    }
+}
+
+template <typename T>
+std::string pack(const T& v) {
+    pack_writer w;
+    pack_value(w, v);
+    return std::move(w.out);
+}
+
+template <typename T>
+T unpack(const char* data, std::size_t size) {
+    T v{};
+    pack_reader r{data, data + size};
+    unpack_value(r, v);
+    return v;
+}
+
+template <typename T>
+T unpack(const std::string& bytes) {
+    return unpack<T>(bytes.data(), bytes.size());
+}
+
+template <typename T>
+std::size_t pack_size(const T& v) {
+    return pack(v).size();
+}
+
+} // namespace eosio
@@ -0,0 +1,426 @@
+#pragma once
+// Native stand-in for eosio::multi_index on top of the in-memory chain.
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+
+#include <eosio/datastream.hpp>
+#include <eosio/native.hpp>
+
+namespace eosio {
+
+constexpr name same_payer{};
+
+template <name::raw IndexName, typename Extractor>
+struct indexed_by {
+    static constexpr uint64_t index_name = static_cast<uint64_t>(IndexName);
+    typedef Extractor secondary_extractor_type;
+};
+
+template <class Class, class Type, Type (Class::*PtrToMemberFunction)() const>
+struct const_mem_fun {
+    typedef std::remove_cv_t<std::remove_reference_t<Type>> result_type;
+    result_type operator()(const Class& x) const { return (x.*PtrToMemberFunction)(); }
+};
+
+namespace native_detail {
+
+inline std::string encode_key(uint64_t v) {
+    std::string s(8, '\0');
+    for (int i = 0; i < 8; ++i) s[i] = char(v >> (56 - 8 * i));
+    return s;
+}
+inline std::string encode_key(uint128_t v) {
+    return encode_key(uint64_t(v >> 64)) + encode_key(uint64_t(v));
+}
+inline std::string encode_key(const checksum256& v) {
+    return std::string(reinterpret_cast<const char*>(v.data()), 32);
+}
+inline std::string encode_key(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, 8);
+    bits = (bits >> 63) ? ~bits : (bits | (1ull << 63));
+    return encode_key(bits);
+}
+
+} // namespace native_detail
+
+template <name::raw TableName, typename T, typename... Indices>
+class multi_index {
+public:
+    static constexpr uint64_t table_name = static_cast<uint64_t>(TableName);
+
+    multi_index(name code, uint64_t scope) : _code(code), _scope(scope) {}
+
+    name get_code() const { return _code; }
+    uint64_t get_scope() const { return _scope; }
+
+    // ---- primary iterator --------------------------------------------------
+
+    struct const_iterator {
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = const T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+        const_iterator(const multi_index* mi, std::optional<uint64_t> pk) : _mi(mi), _pk(pk) {}
+
+        const T& operator*() const {
+            check(_pk.has_value(), "cannot dereference end iterator");
+            return _mi->load(*_pk);
+        }
+        const T* operator->() const { return &**this; }
+
+        const_iterator& operator++() {
+            check(_pk.has_value(), "cannot increment end iterator");
+            _pk = _mi->next_pk(*_pk);
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        const_iterator& operator--() {
+            _pk = _pk ? _mi->prev_pk(*_pk) : _mi->last_pk();
+            check(_pk.has_value(), "cannot decrement iterator at beginning of table");
+            return *this;
+        }
+        const_iterator operator--(int) {
+            auto tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._pk == b._pk; }
+        friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._pk != b._pk; }
+
+        const multi_index* _mi = nullptr;
+        std::optional<uint64_t> _pk;
+    };
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    const_iterator begin() const { return const_iterator(this, first_pk_from(0)); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator end() const { return const_iterator(this, std::nullopt); }
+    const_iterator cend() const { return end(); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    const_iterator lower_bound(uint64_t pk) const { return const_iterator(this, first_pk_from(pk)); }
+    const_iterator upper_bound(uint64_t pk) const {
+        return pk == UINT64_MAX ? end() : const_iterator(this, first_pk_from(pk + 1));
+    }
+
+    const_iterator find(uint64_t pk) const {
+        if (_cache.count(pk)) {
+            ++native::chain::get().counters.db_reads;
+            return const_iterator(this, pk);
+        }
+        auto* r = native::chain::get().find_row(_code, _scope, table_name, pk);
+        if (!r) return end();
+        _cache[pk] = std::make_unique<T>(unpack<T>(r->data));
+        return const_iterator(this, pk);
+    }
+
+    const_iterator require_find(uint64_t pk, const char* msg = "unable to find key") const {
+        auto itr = find(pk);
+        check(itr != end(), msg);
+        return itr;
+    }
+
+    const T& get(uint64_t pk, const char* msg = "unable to find key") const { return *require_find(pk, msg); }
+
+    const_iterator iterator_to(const T& obj) const { return const_iterator(this, obj.primary_key()); }
+
+    uint64_t available_primary_key() const {
+        auto last = last_pk();
+        check(!last || *last < UINT64_MAX - 1, "next primary key in table is at autoincrement limit");
+        return last ? *last + 1 : 0;
+    }
+
+    template <typename Lambda>
+    const_iterator emplace(name payer, Lambda&& constructor) {
+        check(_code == native::chain::get().current_receiver, "cannot create objects in table of another contract");
+        T obj{};
+        constructor(obj);
+        uint64_t pk = obj.primary_key();
+        native::chain::get().store(_code, _scope, table_name, pk, make_row(obj, payer));
+        _cache[pk] = std::make_unique<T>(std::move(obj));
+        return const_iterator(this, pk);
+    }
+
+    template <typename Lambda>
+    void modify(const_iterator itr, name payer, Lambda&& updater) {
+        check(itr != end(), "cannot pass end iterator to modify");
+        modify(*itr, payer, std::forward<Lambda>(updater));
+    }
+
+    template <typename Lambda>
+    void modify(const T& obj, name payer, Lambda&& updater) {
+        check(_code == native::chain::get().current_receiver, "cannot modify objects in table of another contract");
+        uint64_t pk = obj.primary_key();
+        T copy = obj;
+        updater(copy);
+        check(pk == copy.primary_key(), "updater cannot change primary key when modifying an object");
+        auto* existing = native::chain::get().find_table(_code, _scope, table_name);
+        check(existing && existing->rows.count(pk), "object passed to modify is not in multi_index");
+        name effective = payer.value ? payer : existing->rows.at(pk).payer;
+        native::chain::get().update(_code, _scope, table_name, pk, make_row(copy, effective));
+        auto& slot = _cache[pk];
+        if (slot) {
+            *slot = std::move(copy);
+        } else {
+            slot = std::make_unique<T>(std::move(copy));
+        }
+    }
+
+    const_iterator erase(const_iterator itr) {
+        check(itr != end(), "cannot pass end iterator to erase");
+        auto next = itr;
+        uint64_t pk = *itr._pk;
+        auto n = next_pk_uncounted(pk);
+        erase(*itr);
+        return const_iterator(this, n);
+    }
+
+    void erase(const T& obj) {
+        check(_code == native::chain::get().current_receiver, "cannot erase objects in table of another contract");
+        uint64_t pk = obj.primary_key();
+        native::chain::get().remove(_code, _scope, table_name, pk);
+        _cache.erase(pk);
+    }
+
+    // ---- secondary indices --------------------------------------------------
+
+    template <typename IndexSpec>
+    class index {
+    public:
+        using extractor = typename IndexSpec::secondary_extractor_type;
+        using secondary_key_type = typename extractor::result_type;
+        static constexpr uint64_t index_name = IndexSpec::index_name;
+
+        explicit index(const multi_index* mi) : _mi(mi) {}
+
+        struct const_iterator {
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = const T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            const_iterator() = default;
+            const_iterator(const index* idx, std::optional<std::pair<std::string, uint64_t>> pos)
+                : _idx(idx), _pos(std::move(pos)) {}
+
+            const T& operator*() const {
+                check(_pos.has_value(), "cannot dereference end iterator");
+                return _idx->_mi->load(_pos->second);
+            }
+            const T* operator->() const { return &**this; }
+
+            const_iterator& operator++() {
+                check(_pos.has_value(), "cannot increment end iterator");
+                _pos = _idx->next(*_pos);
+                return *this;
+            }
+            const_iterator operator++(int) {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+            const_iterator& operator--() {
+                _pos = _pos ? _idx->prev(*_pos) : _idx->last();
+                check(_pos.has_value(), "cannot decrement iterator at beginning of index");
+                return *this;
+            }
+            const_iterator operator--(int) {
+                auto tmp = *this;
+                --*this;
+                return tmp;
+            }
+
+            friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._pos == b._pos; }
+            friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._pos != b._pos; }
+
+            const index* _idx = nullptr;
+            std::optional<std::pair<std::string, uint64_t>> _pos;
+        };
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        const_iterator begin() const { return const_iterator(this, seek(std::string(), 0)); }
+        const_iterator end() const { return const_iterator(this, std::nullopt); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        const_iterator lower_bound(const secondary_key_type& key) const {
+            return const_iterator(this, seek(native_detail::encode_key(key), 0));
+        }
+        const_iterator upper_bound(const secondary_key_type& key) const {
+            auto enc = native_detail::encode_key(key);
+            auto pos = seek(enc, 0);
+            while (pos && pos->first == enc) pos = next_uncounted(*pos);
+            return const_iterator(this, pos);
+        }
+        const_iterator find(const secondary_key_type& key) const {
+            auto enc = native_detail::encode_key(key);
+            auto pos = seek(enc, 0);
+            if (!pos || pos->first != enc) return end();
+            return const_iterator(this, pos);
+        }
+        const_iterator require_find(const secondary_key_type& key, const char* msg = "unable to find secondary key") const {
+            auto itr = find(key);
+            check(itr != end(), msg);
+            return itr;
+        }
+        const T& get(const secondary_key_type& key, const char* msg = "unable to find secondary key") const {
+            return *require_find(key, msg);
+        }
+        const_iterator iterator_to(const T& obj) const {
+            return const_iterator(this, std::make_pair(native_detail::encode_key(extractor()(obj)), obj.primary_key()));
+        }
+
+        template <typename Lambda>
+        void modify(const_iterator itr, name payer, Lambda&& updater) {
+            const_cast<multi_index*>(_mi)->modify(*itr, payer, std::forward<Lambda>(updater));
+        }
+
+        const_iterator erase(const_iterator itr) {
+            check(itr != end(), "cannot pass end iterator to erase");
+            auto n = next_uncounted(*itr._pos);
+            const_cast<multi_index*>(_mi)->erase(*itr);
+            return const_iterator(this, n);
+        }
+
+    private:
+        const std::set<std::pair<std::string, uint64_t>>* entries() const {
+            auto* t = native::chain::get().find_table(_mi->_code, _mi->_scope, table_name);
+            if (!t) return nullptr;
+            auto it = t->indices.find(index_name);
+            return it == t->indices.end() ? nullptr : &it->second;
+        }
+        std::optional<std::pair<std::string, uint64_t>> seek(const std::string& key, uint64_t pk) const {
+            ++native::chain::get().counters.db_reads;
+            auto* e = entries();
+            if (!e) return std::nullopt;
+            auto it = e->lower_bound({key, pk});
+            if (it == e->end()) return std::nullopt;
+            return *it;
+        }
+        std::optional<std::pair<std::string, uint64_t>> next_uncounted(const std::pair<std::string, uint64_t>& pos) const {
+            auto* e = entries();
+            if (!e) return std::nullopt;
+            auto it = e->upper_bound(pos);
+            if (it == e->end()) return std::nullopt;
+            return *it;
+        }
+        std::optional<std::pair<std::string, uint64_t>> next(const std::pair<std::string, uint64_t>& pos) const {
+            ++native::chain::get().counters.db_reads;
+            return next_uncounted(pos);
+        }
+        std::optional<std::pair<std::string, uint64_t>> prev(const std::pair<std::string, uint64_t>& pos) const {
+            ++native::chain::get().counters.db_reads;
+            auto* e = entries();
+            if (!e) return std::nullopt;
+            auto it = e->lower_bound(pos);
+            if (it == e->begin()) return std::nullopt;
+            return *--it;
+        }
+        std::optional<std::pair<std::string, uint64_t>> last() const {
+            ++native::chain::get().counters.db_reads;
+            auto* e = entries();
+            if (!e || e->empty()) return std::nullopt;
+            return *e->rbegin();
+        }
+
+        const multi_index* _mi;
+    };
+
+    template <name::raw IndexName>
+    auto get_index() const {
+        return index<find_index_t<static_cast<uint64_t>(IndexName), Indices...>>(this);
+    }
+
+private:
+    template <uint64_t Name, typename... I>
+    struct find_index {
+        static_assert(sizeof...(I) > 0, "unable to find index");
+    };
+    template <uint64_t Name, typename First, typename... Rest>
+    struct find_index<Name, First, Rest...> {
+        template <bool Match, typename = void>
+        struct pick {
+            using type = First;
+        };
+        template <typename D>
+        struct pick<false, D> {
+            using type = typename find_index<Name, Rest...>::type;
+        };
+        using type = typename pick<First::index_name == Name>::type;
+    };
+    template <uint64_t Name, typename... I>
+    using find_index_t = typename find_index<Name, I...>::type;
+
+    native::row make_row(const T& obj, name payer) const {
+        native::row r;
+        r.data = pack(obj);
+        r.payer = payer;
+        (r.keys.emplace(Indices::index_name,
+                        native_detail::encode_key(typename Indices::secondary_extractor_type()(obj))),
+         ...);
+        return r;
+    }
+
+    const T& load(uint64_t pk) const {
+        auto it = _cache.find(pk);
+        if (it != _cache.end()) return *it->second;
+        auto* r = native::chain::get().find_row(_code, _scope, table_name, pk);
+        check(r != nullptr, "unable to find row");
+        auto& slot = _cache[pk];
+        slot = std::make_unique<T>(unpack<T>(r->data));
+        return *slot;
+    }
+
+    std::optional<uint64_t> first_pk_from(uint64_t pk) const {
+        ++native::chain::get().counters.db_reads;
+        auto* t = native::chain::get().find_table(_code, _scope, table_name);
+        if (!t) return std::nullopt;
+        auto it = t->rows.lower_bound(pk);
+        if (it == t->rows.end()) return std::nullopt;
+        return it->first;
+    }
+    std::optional<uint64_t> next_pk_uncounted(uint64_t pk) const {
+        auto* t = native::chain::get().find_table(_code, _scope, table_name);
+        if (!t) return std::nullopt;
+        auto it = t->rows.upper_bound(pk);
+        if (it == t->rows.end()) return std::nullopt;
+        return it->first;
+    }
+    std::optional<uint64_t> next_pk(uint64_t pk) const {
+        ++native::chain::get().counters.db_reads;
+        return next_pk_uncounted(pk);
+    }
+    std::optional<uint64_t> prev_pk(uint64_t pk) const {
+        ++native::chain::get().counters.db_reads;
+        auto* t = native::chain::get().find_table(_code, _scope, table_name);
+        if (!t) return std::nullopt;
+        auto it = t->rows.lower_bound(pk);
+        if (it == t->rows.begin()) return std::nullopt;
+        return (--it)->first;
+    }
+    std::optional<uint64_t> last_pk() const {
+        ++native::chain::get().counters.db_reads;
+        auto* t = native::chain::get().find_table(_code, _scope, table_name);
+        if (!t || t->rows.empty()) return std::nullopt;
+        return t->rows.rbegin()->first;
+    }
+
+    name _code;
+    uint64_t _scope;
+    mutable std::map<uint64_t, std::unique_ptr<T>> _cache;
+};
+
+} // namespace eosio
@@ -0,0 +1,321 @@
+#pragma once
+// In-memory chain used by the native harness: key-value storage with
+// secondary indexes, RAM accounting, authorization, inline actions,
+// notifications and transaction rollback.
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+struct permission_level {
+    permission_level() = default;
+    permission_level(name a, name p) : actor(a), permission(p) {}
+    name actor;
+    name permission;
+};
+
+namespace native {
+
+// Billable RAM sizes used by nodeos (chain/config.hpp).
+constexpr int64_t row_overhead = 108;            // key_value_object
+constexpr int64_t table_overhead = 108;          // table_id_object
+constexpr int64_t secondary_overhead_base = 120; // index object overhead without the key
+
+struct row {
+    std::string data;
+    name payer;
+    std::map<uint64_t, std::string> keys; // index name -> encoded secondary key
+};
+
+struct table {
+    std::map<uint64_t, row> rows;
+    std::map<uint64_t, std::set<std::pair<std::string, uint64_t>>> indices;
+};
+
+using table_key = std::tuple<uint64_t, uint64_t, uint64_t>; // code, scope, table
+
+// Counters exposed to tests and benchmarks.
+struct stats {
+    uint64_t db_reads = 0;
+    uint64_t db_writes = 0;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    uint64_t inline_actions = 0;
+    uint64_t notifications = 0;
+
+    stats operator-(const stats& o) const {
+        return {db_reads - o.db_reads,           db_writes - o.db_writes,
+                bytes_read - o.bytes_read,       bytes_written - o.bytes_written,
+                inline_actions - o.inline_actions, notifications - o.notifications};
+    }
+};
+
+struct action_data {
+    name account;
+    name action_name;
+    std::vector<permission_level> authorization;
+    std::string data;
+};
+
+// One executed action, kept so tests can inspect transfers and logs.
+struct action_trace {
+    name receiver;
+    name account;
+    name action_name;
+    std::string data;
+    std::string console;
+    std::string return_value;
+};
+
+class chain {
+public:
+    using handler = std::function<void(name receiver, name code, const std::string& data)>;
+
+    static chain& get() {
+        static chain c;
+        return c;
+    }
+
+    // Drops all state, handlers included, so a benchmark can start from an empty chain.
+    static void reset() { get() = chain(); }
+
+    // ---- storage ------------------------------------------------------------
+
+    table* find_table(name code, uint64_t scope, uint64_t tbl) {
+        auto it = tables.find({code.value, scope, tbl});
+        return it == tables.end() ? nullptr : &it->second;
+    }
+
+    const row* find_row(name code, uint64_t scope, uint64_t tbl, uint64_t pk) {
+        ++counters.db_reads;
+        auto* t = find_table(code, scope, tbl);
+        if (!t) return nullptr;
+        auto it = t->rows.find(pk);
+        if (it == t->rows.end()) return nullptr;
+        counters.bytes_read += it->second.data.size();
+        return &it->second;
+    }
+
+    void store(name code, uint64_t scope, uint64_t tbl, uint64_t pk, row r) {
+        check(r.payer.value != 0, "must specify a valid account to pay for new record");
+        auto key = table_key{code.value, scope, tbl};
+        auto& t = tables[key];
+        check(t.rows.find(pk) == t.rows.end(), "could not insert object, most likely a uniqueness constraint was violated");
+        if (t.rows.empty()) ram[code.value] += table_overhead;
+        record_undo(key, pk);
+        ++counters.db_writes;
+        counters.bytes_written += r.data.size();
+        charge(r, +1);
+        for (auto& [idx, k] : r.keys) t.indices[idx].insert({k, pk});
+        t.rows.emplace(pk, std::move(r));
+    }
+
+    void update(name code, uint64_t scope, uint64_t tbl, uint64_t pk, row r) {
+        auto key = table_key{code.value, scope, tbl};
+        auto& t = tables[key];
+        auto it = t.rows.find(pk);
+        check(it != t.rows.end(), "cannot update a missing row");
+        record_undo(key, pk);
+        ++counters.db_writes;
+        counters.bytes_written += r.data.size();
+        charge(it->second, -1);
+        for (auto& [idx, k] : it->second.keys) t.indices[idx].erase({k, pk});
+        charge(r, +1);
+        for (auto& [idx, k] : r.keys) t.indices[idx].insert({k, pk});
+        it->second = std::move(r);
+    }
+
+    void remove(name code, uint64_t scope, uint64_t tbl, uint64_t pk) {
+        auto key = table_key{code.value, scope, tbl};
+        auto& t = tables[key];
+        auto it = t.rows.find(pk);
+        check(it != t.rows.end(), "cannot remove a missing row");
+        record_undo(key, pk);
+        ++counters.db_writes;
+        charge(it->second, -1);
+        for (auto& [idx, k] : it->second.keys) t.indices[idx].erase({k, pk});
+        t.rows.erase(it);
+        if (t.rows.empty()) {
+            ram[code.value] -= table_overhead;
+            tables.erase(key);
+        }
+    }
+
+    // Number of rows in a table, for tests only (not counted as a DB read).
+    std::size_t row_count(name code, uint64_t scope, name tbl) {
+        auto* t = find_table(code, scope, tbl.value);
+        return t ? t->rows.size() : 0;
+    }
+
+    int64_t ram_usage(name account) const {
+        auto it = ram.find(account.value);
+        return it == ram.end() ? 0 : it->second;
+    }
+
+    // ---- time / authorization -------------------------------------------------
+
+    time_point now{seconds(1700000000)};
+
+    void advance(microseconds m) { now = now + m; }
+
+    bool has_auth(name n) const {
+        for (const auto& p : current_auth)
+            if (p.actor == n) return true;
+        return false;
+    }
+
+    bool is_account(name n) const { return accounts.count(n.value) > 0; }
+    void create_account(name n) { accounts.insert(n.value); }
+
+    // ---- dispatch ---------------------------------------------------------------
+
+    void set_handler(name account, name act, handler h) {
+        create_account(account);
+        handlers[{account.value, act.value}] = std::move(h);
+    }
+    void set_notify_handler(name account, name act, handler h) {
+        create_account(account);
+        notify_handlers[{account.value, act.value}] = std::move(h);
+    }
+
+    void send_inline(action_data a) {
+        ++counters.inline_actions;
+        pending_inline.back().push_back(std::move(a));
+    }
+
+    void require_recipient(name n) {
+        if (n == current_receiver) return;
+        for (auto& r : pending_notify.back())
+            if (r == n) return;
+        pending_notify.back().push_back(n);
+    }
+
+    void print(const std::string& s) { console += s; }
+    void set_return_value(std::string v) { return_value = std::move(v); }
+
+    // Pushes a transaction made of one action; returns false (and rolls back)
+    // when any assertion fails. The failure message is kept in last_error.
+    bool push(action_data a) {
+        undo_log.clear();
+        traces.clear();
+        last_error.clear();
+        in_transaction = true;
+        try {
+            execute(a, a.account, a.account);
+        } catch (const eosio_assert_exception& e) {
+            last_error = e.what();
+            rollback();
+            in_transaction = false;
+            return false;
+        }
+        in_transaction = false;
+        undo_log.clear();
+        return true;
+    }
+
+    std::vector<action_trace> traces;
+    std::string last_error;
+    stats counters;
+
+    name current_receiver;
+    name current_code;
+
+private:
+    void execute(const action_data& a, name receiver, name code) {
+        auto saved_auth = current_auth;
+        auto saved_receiver = current_receiver;
+        auto saved_code = current_code;
+        current_auth = a.authorization;
+        current_receiver = receiver;
+        current_code = code;
+        pending_inline.emplace_back();
+        pending_notify.emplace_back();
+        console.clear();
+        return_value.clear();
+
+        if (receiver == code) {
+            auto it = handlers.find({receiver.value, a.action_name.value});
+            check(it != handlers.end(), "no handler for " + receiver.to_string() + "::" + a.action_name.to_string());
+            it->second(receiver, code, a.data);
+        } else {
+            auto it = notify_handlers.find({receiver.value, a.action_name.value});
+            if (it != notify_handlers.end()) it->second(receiver, code, a.data);
+        }
+        traces.push_back({receiver, a.account, a.action_name, a.data, console, return_value});
+
+        auto notify = std::move(pending_notify.back());
+        auto inlines = std::move(pending_inline.back());
+        pending_notify.pop_back();
+        pending_inline.pop_back();
+
+        for (auto n : notify) {
+            ++counters.notifications;
+            execute(a, n, code);
+        }
+        current_auth = saved_auth;
+        for (auto& in : inlines) execute(in, in.account, in.account);
+        current_auth = saved_auth;
+        current_receiver = saved_receiver;
+        current_code = saved_code;
+    }
+
+    void charge(const row& r, int sign) {
+        int64_t bytes = row_overhead + int64_t(r.data.size());
+        for (auto& [idx, k] : r.keys) bytes += secondary_overhead_base + int64_t(k.size());
+        ram[r.payer.value] += sign * bytes;
+    }
+
+    void record_undo(const table_key& key, uint64_t pk) {
+        if (!in_transaction) return;
+        std::optional<row> before;
+        auto it = tables.find(key);
+        if (it != tables.end()) {
+            auto r = it->second.rows.find(pk);
+            if (r != it->second.rows.end()) before = r->second;
+        }
+        undo_log.push_back({key, pk, std::move(before)});
+    }
+
+    void rollback() {
+        bool saved = in_transaction;
+        in_transaction = false;
+        for (auto it = undo_log.rbegin(); it != undo_log.rend(); ++it) {
+            auto& [key, pk, before] = *it;
+            name code{std::get<0>(key)};
+            auto* t = find_table(code, std::get<1>(key), std::get<2>(key));
+            if (t && t->rows.count(pk)) remove(code, std::get<1>(key), std::get<2>(key), pk);
+            if (before) store(code, std::get<1>(key), std::get<2>(key), pk, *before);
+        }
+        undo_log.clear();
+        in_transaction = saved;
+    }
+
+    std::map<table_key, table> tables;
+    std::map<uint64_t, int64_t> ram;
+    std::set<uint64_t> accounts;
+    std::map<std::pair<uint64_t, uint64_t>, handler> handlers;
+    std::map<std::pair<uint64_t, uint64_t>, handler> notify_handlers;
+    std::vector<permission_level> current_auth;
+    std::vector<std::vector<action_data>> pending_inline;
+    std::vector<std::vector<name>> pending_notify;
+    std::vector<std::tuple<table_key, uint64_t, std::optional<row>>> undo_log;
+    std::string console;
+    std::string return_value;
+    bool in_transaction = false;
+};
+
+} // namespace native
+} // namespace eosio
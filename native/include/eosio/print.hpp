@@ -0,0 +1,34 @@
+#pragma once
+// Native stand-in for eosio::print: output goes to the action's console.
+#include <string>
+#include <type_traits>
+
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native.hpp>
+
+namespace eosio {
+
+namespace native_detail {
+inline std::string to_console(const char* s) { return s; }
+inline std::string to_console(const std::string& s) { return s; }
+inline std::string to_console(name n) { return n.to_string(); }
+inline std::string to_console(const asset& a) { return a.to_string(); }
+inline std::string to_console(const symbol& s) { return s.to_string(); }
+inline std::string to_console(bool b) { return b ? "true" : "false"; }
+template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+std::string to_console(T v) { return std::to_string(v); }
+} // namespace native_detail
+
+template <typename... Args>
+void print(Args&&... args) {
+    (native::chain::get().print(native_detail::to_console(args)), ...);
+}
+
+template <typename... Args>
+void print_f(const char* fmt, Args&&... args) {
+    native::chain::get().print(fmt);
+    (native::chain::get().print(" " + native_detail::to_console(args)), ...);
+}
+
+} // namespace eosio
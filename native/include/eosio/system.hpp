@@ -0,0 +1,11 @@
+#pragma once
+// Native stand-in for eosio/system.hpp.
+#include <eosio/native.hpp>
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+inline time_point current_time_point() { return native::chain::get().now; }
+inline time_point_sec current_block_time() { return time_point_sec(native::chain::get().now); }
+
+} // namespace eosio
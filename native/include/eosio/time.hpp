@@ -0,0 +1,53 @@
+#pragma once
+// Native stand-in for eosio time types.
+#include <cstdint>
+
+namespace eosio {
+
+class microseconds {
+public:
+    constexpr explicit microseconds(int64_t c = 0) : _count(c) {}
+    constexpr int64_t count() const { return _count; }
+    constexpr int64_t to_seconds() const { return _count / 1000000; }
+    friend constexpr bool operator==(const microseconds& a, const microseconds& b) { return a._count == b._count; }
+    friend constexpr bool operator<(const microseconds& a, const microseconds& b) { return a._count < b._count; }
+    friend constexpr microseconds operator+(const microseconds& a, const microseconds& b) { return microseconds(a._count + b._count); }
+    friend constexpr microseconds operator-(const microseconds& a, const microseconds& b) { return microseconds(a._count - b._count); }
+    int64_t _count;
+};
+
+inline constexpr microseconds seconds(int64_t s) { return microseconds(s * 1000000); }
+inline constexpr microseconds minutes(int64_t m) { return seconds(60 * m); }
+inline constexpr microseconds hours(int64_t h) { return minutes(60 * h); }
+inline constexpr microseconds days(int64_t d) { return hours(24 * d); }
+
+class time_point {
+public:
+    constexpr explicit time_point(microseconds e = microseconds()) : elapsed(e) {}
+    constexpr const microseconds& time_since_epoch() const { return elapsed; }
+    constexpr uint32_t sec_since_epoch() const { return uint32_t(elapsed.count() / 1000000); }
+    friend constexpr bool operator<(const time_point& a, const time_point& b) { return a.elapsed < b.elapsed; }
+    friend constexpr bool operator==(const time_point& a, const time_point& b) { return a.elapsed == b.elapsed; }
+    friend constexpr time_point operator+(const time_point& t, const microseconds& m) { return time_point(t.elapsed + m); }
+    friend constexpr time_point operator-(const time_point& t, const microseconds& m) { return time_point(t.elapsed - m); }
+    microseconds elapsed;
+};
+
+class time_point_sec {
+public:
+    constexpr time_point_sec() : utc_seconds(0) {}
+    constexpr explicit time_point_sec(uint32_t seconds) : utc_seconds(seconds) {}
+    constexpr time_point_sec(const time_point& t) : utc_seconds(uint32_t(t.time_since_epoch().count() / 1000000ll)) {}
+    constexpr uint32_t sec_since_epoch() const { return utc_seconds; }
+    constexpr operator time_point() const { return time_point(eosio::seconds(utc_seconds)); }
+    friend constexpr bool operator<(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds < b.utc_seconds; }
+    friend constexpr bool operator<=(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds <= b.utc_seconds; }
+    friend constexpr bool operator>(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds > b.utc_seconds; }
+    friend constexpr bool operator==(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds == b.utc_seconds; }
+    friend constexpr bool operator!=(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds != b.utc_seconds; }
+    friend constexpr time_point_sec operator+(const time_point_sec& t, uint32_t offset) { return time_point_sec(t.utc_seconds + offset); }
+    friend constexpr time_point_sec operator-(const time_point_sec& t, uint32_t offset) { return time_point_sec(t.utc_seconds - offset); }
+    uint32_t utc_seconds;
+};
+
+} // namespace eosio
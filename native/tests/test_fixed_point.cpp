@@ -0,0 +1,64 @@
+// Properties of the fixed-point helpers over random inputs
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../../common/fixed_point.hpp"
+
+#define CHECK(cond)                                                       \
+    do {                                                                  \
+        if (!(cond)) {                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,   \
+                         __LINE__, #cond);                                \
+            std::exit(1);                                                 \
+        }                                                                 \
+    } while (0)
+
+int main() {
+    const int64_t max_amount = (1LL << 62) - 1;
+    std::mt19937_64 rng(20240101);
+
+    for (int round = 0; round < 100000; round++) {
+        // Small amounts as often as large ones, the rounding edge cases live there
+        int64_t amount = round % 2 ? int64_t(rng() % 1000) : int64_t(rng() % max_amount);
+        uint32_t fee_bps = rng() % 20000;
+        uint32_t slippage_bps = rng() % 20000;
+
+        // fee = floor(amount * fee / (100% + fee + slippage))
+        int64_t fee = fixed_point::fee_amount(amount, fee_bps, slippage_bps);
+        fixed_point::uint128 denominator = fixed_point::uint128(fixed_point::BPS_DENOMINATOR) + fee_bps + slippage_bps;
+        CHECK(fee >= 0 && fee <= amount);
+        CHECK(fixed_point::uint128(fee) * denominator <= fixed_point::uint128(amount) * fee_bps);
+        CHECK(fixed_point::uint128(fee + 1) * denominator > fixed_point::uint128(amount) * fee_bps);
+
+        // The parts add up to the amount and each is within one unit of its exact share
+        size_t count = 1 + rng() % 20;
+        std::vector<uint64_t> weights(count);
+        uint64_t total_weight = 0;
+        for (auto& weight : weights) {
+            weight = round % 3 ? 1 + rng() % 0xFFFFFFFF : 1 + rng() % 10;
+            total_weight += weight;
+        }
+        int64_t rest = amount - fee;
+        fixed_point::weighted_splitter splitter{rest, total_weight};
+        int64_t sum = 0;
+        for (auto weight : weights) {
+            int64_t part = splitter.next(weight);
+            CHECK(part >= 0);
+            __int128 exact = __int128(rest) * weight;
+            __int128 scaled = __int128(part) * total_weight;
+            CHECK(scaled - exact < __int128(total_weight) && exact - scaled < __int128(total_weight));
+            sum += part;
+        }
+        CHECK(sum == rest);
+    }
+
+    CHECK(fixed_point::clamp_bps(5, 10, 20) == 10);
+    CHECK(fixed_point::clamp_bps(25, 10, 20) == 20);
+    CHECK(fixed_point::clamp_bps(15, 10, 20) == 15);
+    CHECK(fixed_point::percent_to_bps(1.5) == 150);
+    CHECK(fixed_point::percent_to_bps(-1) == 0);
+    CHECK(fixed_point::usd_to_fixed(0.1) == 10000000);
+    return 0;
+}
@@ -0,0 +1,166 @@
+// One-off upgrade actions run against tables that already hold rows in the new
+// layout: twl migrate/pushcfg/reindex/cls and swl migrate/indextokens/reindex
+#include "fixture.hpp"
+
+using namespace waxpay_native;
+
+// Old twl rows (double percentages, image in the row) next to a whitelist row
+// written since the upgrade
+void twl_migrations() {
+    deploy();
+    as_contract(TWL, [&] {
+        native_access::twl_tokens_v1 old_tokens(TWL, TWL.value);
+        for (uint64_t id = 0; id < 3; id++) {
+            old_tokens.emplace(TWL, [&](auto& row) {
+                row.id = id;
+                row.contract = TOKEN;
+                row.symbol = token_symbol(id);
+                row.image_link = "https://example.com/" + std::to_string(id) + ".png";
+                row.system_fee = 1.5;
+                row.slippage = 0.25;
+            });
+        }
+        native_access::twl_tokens tokens(TWL, TWL.value);
+        tokens.emplace(TWL, [&](auto& row) {
+            row.id = 5;
+            row.contract = TOKEN;
+            row.symbol = token_symbol(5);
+            row.system_fee = 200;
+            row.slippage = 10;
+        });
+    });
+
+    // Nothing unconverted is pushed to waxpayio, and no token is added, before migrate
+    auto token_config = [&]() { return waxpay::tokencfg_table(WAXPAY, WAXPAY.value); };
+    CHECK(push(TWL, TWL, "pushcfg"_n, uint64_t(0), uint32_t(10)));
+    CHECK(token_config().find(0) == token_config().end());
+    CHECK(token_config().get(5).system_fee == 200);
+    CHECK(!push(TWL, TWL, "addtoken"_n, TOKEN, WAX, std::string(""), uint32_t(100)));
+    CHECK(eosio::native::chain::get().last_error == "Run migrate before adding tokens");
+
+    CHECK(push(TWL, TWL, "migrate"_n, uint64_t(0), uint32_t(2)));
+    CHECK(console() == "Next id: 2");
+    CHECK(push(TWL, TWL, "migrate"_n, uint64_t(2), uint32_t(2)));
+    CHECK(console().empty());
+    CHECK(eosio::native::chain::get().row_count(TWL, TWL.value, "tokens"_n) == 0);
+
+    native_access::twl_tokens tokens(TWL, TWL.value);
+    for (uint64_t id = 0; id < 3; id++) {
+        CHECK(tokens.get(id).system_fee == 150 && tokens.get(id).slippage == 25);
+        CHECK(tokens.get(id).symbol == token_symbol(id));
+    }
+    CHECK(tokens.get(5).system_fee == 200 && tokens.get(5).slippage == 10);
+    native_access::twl_tokenmeta meta(TWL, TWL.value);
+    CHECK(meta.get(1).image_link == "https://example.com/1.png");
+
+    // pushcfg hands the converted settings to waxpayio
+    CHECK(push(TWL, TWL, "pushcfg"_n, uint64_t(0), uint32_t(10)));
+    CHECK(token_config().get(2).system_fee == 150);
+
+    // New tokens get ids after every migrated one
+    uint64_t wax_id = add_token(WAX, 100);
+    CHECK(wax_id == 6);
+
+    // reindex re-emplaces rows in batches and keeps the bytoken lookup working
+    CHECK(push(TWL, TWL, "reindex"_n, uint64_t(0), uint32_t(2)));
+    CHECK(console() == "Next id: 2");
+    CHECK(push(TWL, TWL, "reindex"_n, uint64_t(2), uint32_t(10)));
+    CHECK(console().empty());
+    CHECK(!push(TWL, TWL, "addtoken"_n, TOKEN, WAX, std::string(""), uint32_t(100)));
+    CHECK(eosio::native::chain::get().last_error == "Token contract already whitelisted");
+    CHECK(tokens.get(wax_id).symbol == WAX);
+
+    // cls clears both tables in batches and drops waxpayio's copies
+    as_contract(TWL, [&] {
+        native_access::twl_tokens_v1 old_tokens(TWL, TWL.value);
+        old_tokens.emplace(TWL, [&](auto& row) {
+            row.id = 20;
+            row.contract = TOKEN;
+            row.symbol = token_symbol(20);
+            row.system_fee = 1;
+            row.slippage = 0;
+        });
+    });
+    CHECK(push(TWL, TWL, "cls"_n, uint32_t(3)));
+    CHECK(console().empty());
+    CHECK(push(TWL, TWL, "cls"_n, uint32_t(10)));
+    CHECK(console() == "Clear done");
+    auto& chain = eosio::native::chain::get();
+    CHECK(chain.row_count(TWL, TWL.value, "tokens"_n) == 0);
+    CHECK(chain.row_count(TWL, TWL.value, "whitelist"_n) == 0);
+    CHECK(chain.row_count(TWL, TWL.value, "tokenmeta"_n) == 0);
+    CHECK(chain.row_count(WAXPAY, WAXPAY.value, "tokencfg"_n) == 0);
+}
+
+// Old swl store token rows (doubles) in some stores, basis-point rows in others
+void swl_migrations() {
+    eosio::native::chain::reset();
+    deploy();
+    auto& chain = eosio::native::chain::get();
+    uint64_t token_id = add_token(WAX, 100);
+
+    std::vector<name> owners;
+    std::vector<uint64_t> stores;
+    for (uint32_t i = 0; i < 3; i++) {
+        owners.push_back(account("shop", i));
+        stores.push_back(add_store(owners.back(), 2));
+    }
+    // Store 1 took the token since the upgrade; stores 0 and 2 still have old rows
+    accept_token(owners[1], token_id);
+    for (uint64_t store : {stores[0], stores[2]}) {
+        as_contract(SWL, [&] {
+            native_access::swl_tokens_v1 old_tokens(SWL, store);
+            old_tokens.emplace(SWL, [&](auto& row) {
+                row.id = token_id;
+                row.min_slippage = 0.5;
+                row.max_slippage = 2.5;
+                row.active = true;
+                row.usd_value = 1.25;
+            });
+        });
+    }
+
+    // An owner action moves its own store's rows before touching them
+    CHECK(push(owners[0], SWL, "changestate"_n, owners[0], token_id, false));
+    CHECK(chain.row_count(SWL, stores[0], "tokens"_n) == 0);
+    auto moved = native_access::swl_tokens(SWL, stores[0]).get(token_id);
+    CHECK(moved.min_slippage == 50 && moved.max_slippage == 250);
+    CHECK(moved.usd_value == 125000000 && !moved.active);
+    auto profile = waxpay::profiles_table(WAXPAY, stores[0]).get(token_id);
+    CHECK(profile.max_slippage == 250 && !profile.active);
+
+    // migrate converts the rest and leaves rows written since alone
+    CHECK(push(SWL, SWL, "migrate"_n, uint64_t(0), uint32_t(2)));
+    CHECK(console() == "Next store id: " + std::to_string(stores[2]));
+    CHECK(push(SWL, SWL, "migrate"_n, stores[2], uint32_t(2)));
+    CHECK(console().empty());
+    CHECK(chain.row_count(SWL, stores[2], "tokens"_n) == 0);
+    CHECK(native_access::swl_tokens(SWL, stores[2]).get(token_id).max_slippage == 250);
+    auto fresh = native_access::swl_tokens(SWL, stores[1]).get(token_id);
+    CHECK(fresh.min_slippage == 0 && fresh.max_slippage == fixed_point::BPS_DENOMINATOR);
+    CHECK(!native_access::swl_tokens(SWL, stores[0]).get(token_id).active);
+
+    // indextokens lists the moved stores under the token; pushprofiles gives waxpayio theirs
+    CHECK(chain.row_count(SWL, token_id, "tokenstores"_n) == 1);
+    CHECK(push(SWL, SWL, "indextokens"_n, uint64_t(0), uint32_t(2)));
+    CHECK(console() == "Next store id: " + std::to_string(stores[2]));
+    CHECK(push(SWL, SWL, "indextokens"_n, stores[2], uint32_t(2)));
+    CHECK(chain.row_count(SWL, token_id, "tokenstores"_n) == 3);
+    CHECK(push(SWL, SWL, "pushprofiles"_n, uint64_t(0), uint32_t(10)));
+    CHECK(waxpay::profiles_table(WAXPAY, stores[2]).get(token_id).max_slippage == 250);
+
+    // reindex re-emplaces stores in batches; byaccount and bystoreid still find them
+    CHECK(push(SWL, SWL, "reindex"_n, uint64_t(0), uint32_t(2)));
+    CHECK(console() == "Next id: " + std::to_string(stores[2]));
+    CHECK(push(SWL, SWL, "reindex"_n, stores[2], uint32_t(2)));
+    CHECK(console().empty());
+    CHECK(push(owners[2], SWL, "changestate"_n, owners[2], token_id, false));
+    CHECK(!push(SWL, SWL, "addstore"_n, owners[2].to_string(), std::string("Store"), account("late", 0)));
+    CHECK(eosio::native::chain::get().last_error == "Store already registered");
+}
+
+int main() {
+    twl_migrations();
+    swl_migrations();
+    return 0;
+}
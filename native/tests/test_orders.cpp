@@ -0,0 +1,87 @@
+// Pending order storage: store scopes, batch actions, expiry and the row migration
+#include "fixture.hpp"
+
+using namespace waxpay_native;
+
+int main() {
+    auto& chain = eosio::native::chain::get();
+    deploy();
+    uint64_t token_id = add_token(WAX, 100);
+    name owner = account("shop", 0);
+    uint64_t store = add_store(owner, 2);
+    accept_token(owner, token_id);
+    std::string prefix = std::to_string(store) + ":";
+
+    // Structured memos go to the store's scope, others to the legacy scope
+    CHECK(pay(asset(101000000, WAX), prefix + "a"));
+    CHECK(pay(asset(101000000, WAX), "legacy-a"));
+    CHECK(chain.row_count(WAXPAY, store, "pending"_n) == 1);
+    CHECK(chain.row_count(WAXPAY, WAXPAY.value, "pending"_n) == 1);
+
+    // Batches report unknown ids through orderfailed and settle the rest
+    std::vector<std::string> ids{prefix + "a", "legacy-a", prefix + "missing"};
+    CHECK(push(WAXPAY, WAXPAY, "acceptorders"_n, ids, store, std::string("thanks")));
+    CHECK(chain.traces.size() > 0);
+    CHECK(chain.row_count(WAXPAY, store, "pending"_n) == 0);
+    CHECK(chain.row_count(WAXPAY, WAXPAY.value, "pending"_n) == 0);
+    int failed = 0;
+    for (auto& trace : chain.traces) failed += trace.action_name == "orderfailed"_n;
+    CHECK(failed == 1);
+
+    // Orders older than the TTL are refunded oldest first, `limit` at a time
+    CHECK(pay(asset(10000, WAX), prefix + "old"));
+    chain.advance(eosio::seconds(100));
+    CHECK(pay(asset(20000, WAX), prefix + "new1"));
+    CHECK(pay(asset(30000, WAX), prefix + "new2"));
+    CHECK(push(PAYER, WAXPAY, "expire"_n, store, uint32_t(10)));
+    CHECK(console() == "Expired orders: 0");
+    CHECK(!push(PAYER, WAXPAY, "setttl"_n, uint32_t(50)));
+    CHECK(push(WAXPAY, WAXPAY, "setttl"_n, uint32_t(50)));
+    chain.advance(eosio::seconds(100));
+    CHECK(push(PAYER, WAXPAY, "expire"_n, store, uint32_t(2)));
+    CHECK(console() == "Expired orders: 2");
+    CHECK(push(PAYER, WAXPAY, "getorder"_n, prefix + "new2"));
+    native_access::waxpay_balances balances(WAXPAY, PAYER.value);
+    CHECK(balances.begin()->asset == asset(30000, WAX));
+
+    // Rows left in `orders` with the memo string move to `pending`, alongside
+    // orders paid after the deploy, which the migration never reads
+    native_access::waxpay_orders_v1 old_orders(WAXPAY, WAXPAY.value);
+    as_contract(WAXPAY, [&] {
+        for (uint64_t id = 0; id < 4; id++) {
+            old_orders.emplace(WAXPAY, [&](auto& row) {
+                row.id = id;
+                // The last one was paid with a store memo before orders were scoped by store
+                row.system_id = id < 3 ? "legacy-" + std::to_string(id) : prefix + "before-scopes";
+                row.sender = PAYER;
+                row.token_contract = TOKEN;
+                row.asset = asset(5000, WAX);
+                row.timestamp = time_point_sec(chain.now);
+            });
+        }
+    });
+    CHECK(pay(asset(6000, WAX), "after-deploy-0"));
+    CHECK(push(WAXPAY, WAXPAY, "migrateords"_n, WAXPAY.value, uint32_t(2)));
+    CHECK(console().empty());
+    CHECK(pay(asset(7000, WAX), "after-deploy-1"));
+    CHECK(push(WAXPAY, WAXPAY, "migrateords"_n, WAXPAY.value, uint32_t(2)));
+    CHECK(console() == "Migration done");
+    CHECK(push(WAXPAY, WAXPAY, "migrateords"_n, WAXPAY.value, uint32_t(2)));
+    CHECK(console() == "Migration done");
+    CHECK(chain.row_count(WAXPAY, WAXPAY.value, "orders"_n) == 0);
+    CHECK(chain.row_count(WAXPAY, WAXPAY.value, "pending"_n) == 6);
+
+    CHECK(push(WAXPAY, WAXPAY, "rejectorder"_n, std::string("legacy-1")));
+    CHECK(!push(WAXPAY, WAXPAY, "rejectorder"_n, std::string("legacy-1")));
+    CHECK(push(PAYER, WAXPAY, "getorder"_n, std::string("after-deploy-1")));
+    CHECK(result<waxpay::order_info>().asset == asset(7000, WAX));
+    CHECK(push(PAYER, WAXPAY, "getorder"_n, std::string("legacy-2")));
+    CHECK(result<waxpay::order_info>().asset == asset(5000, WAX));
+
+    // A store memo paid before orders were scoped by store is found in the legacy scope
+    CHECK(push(PAYER, WAXPAY, "getorder"_n, prefix + "before-scopes"));
+    CHECK(result<waxpay::order_info>().scope == WAXPAY.value);
+    CHECK(push(WAXPAY, WAXPAY, "acceptorder"_n, prefix + "before-scopes", store, std::string("thanks")));
+    CHECK(chain.row_count(WAXPAY, WAXPAY.value, "pending"_n) == 4);
+    return 0;
+}
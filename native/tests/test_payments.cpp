@@ -0,0 +1,160 @@
+// Payment flow: orderpaid, acceptorder, rejectorder(s)/claim, quote, pull-mode
+// payouts with withdraw and settle, and tokens from unlisted or look-alike contracts
+#include "fixture.hpp"
+
+using namespace waxpay_native;
+
+int main() {
+    deploy();
+    uint64_t token_id = add_token(WAX, 100);
+    name owner = account("shop", 0);
+    uint64_t store = add_store(owner, 2);
+    accept_token(owner, token_id);
+    name bob = account("rcpt", 0);
+    name carol = account("rcpt", 1);
+    std::string prefix = std::to_string(store) + ":";
+
+    // The quote is what acceptorder pays out, to the unit
+    CHECK(push(bob, WAXPAY, "quote"_n, store, token_id, int64_t(101000001)));
+    auto quote = result<waxpay::quote_result>();
+    CHECK(quote.fee == asset(1000000, WAX));
+    CHECK(quote.shares.size() == 2);
+    CHECK(quote.shares[0].recipient == bob && quote.shares[0].amount == asset(33333333, WAX));
+    CHECK(quote.shares[1].recipient == carol && quote.shares[1].amount == asset(66666668, WAX));
+
+    CHECK(pay(asset(101000001, WAX), prefix + "a"));
+    CHECK(!pay(asset(5000, WAX), prefix + "a"));
+    CHECK(push(WAXPAY, WAXPAY, "acceptorder"_n, prefix + "a", store, std::string("thanks")));
+    CHECK(balance(bob, WAX) == 33333333);
+    CHECK(balance(carol, WAX) == 66666668);
+
+    // The fee accrues on fee.waxpayio's ledger row until settle pays it out
+    CHECK(push(bob, WAXPAY, "settle"_n, store, token_id, uint32_t(10)));
+    CHECK(balance("fee.waxpayio"_n, WAX) == 1000000);
+    CHECK(balance(WAXPAY, WAX) == 0);
+
+    // Rejected orders are refunded through claim
+    int64_t before = balance(PAYER, WAX);
+    CHECK(pay(asset(5000, WAX), prefix + "b"));
+    CHECK(push(PAYER, WAXPAY, "getorder"_n, prefix + "b"));
+    CHECK(result<waxpay::order_info>().scope == store);
+    CHECK(push(WAXPAY, WAXPAY, "rejectorder"_n, prefix + "b"));
+    CHECK(!push(WAXPAY, WAXPAY, "rejectorder"_n, prefix + "b"));
+    CHECK(push(PAYER, WAXPAY, "getbalances"_n, PAYER));
+    CHECK(result<std::vector<waxpay::balance_info>>().at(0).balance == asset(5000, WAX));
+    CHECK(push(PAYER, WAXPAY, "claim"_n, PAYER, uint32_t(5)));
+    CHECK(balance(PAYER, WAX) == before);
+
+    // Pull mode credits the payouts ledger; withdraw sends a recipient's balance in one transfer
+    CHECK(push(owner, SWL, "setpullmode"_n, owner, true));
+    int64_t bob_before = balance(bob, WAX);
+    int64_t carol_before = balance(carol, WAX);
+    for (auto id : {"p1", "p2"}) {
+        CHECK(pay(asset(101000001, WAX), prefix + id));
+        CHECK(push(WAXPAY, WAXPAY, "acceptorder"_n, prefix + id, store, std::string("thanks")));
+    }
+    CHECK(balance(bob, WAX) == bob_before);
+    CHECK(push(PAYER, WAXPAY, "withdraw"_n, bob, token_id));
+    CHECK(balance(bob, WAX) == bob_before + 2 * 33333333);
+    CHECK(!push(PAYER, WAXPAY, "withdraw"_n, bob, token_id));
+
+    // settle pays the fee, then at most `limit` recipients per call from its cursor
+    int64_t fee_before = balance("fee.waxpayio"_n, WAX);
+    CHECK(push(PAYER, WAXPAY, "settle"_n, store, token_id, uint32_t(1)));
+    CHECK(console() == "Next recipient: " + carol.to_string());
+    CHECK(eosio::native::chain::get().row_count(WAXPAY, store, "settlements"_n) == 1);
+    CHECK(balance("fee.waxpayio"_n, WAX) == fee_before + 2 * 1000000);
+    CHECK(balance(carol, WAX) == carol_before);
+    CHECK(push(PAYER, WAXPAY, "settle"_n, store, token_id, uint32_t(1)));
+    CHECK(balance(carol, WAX) == carol_before + 2 * 66666668);
+    CHECK(balance("fee.waxpayio"_n, WAX) == fee_before + 2 * 1000000);
+    CHECK(eosio::native::chain::get().row_count(WAXPAY, store, "settlements"_n) == 0);
+    CHECK(!push(PAYER, WAXPAY, "settle"_n, store, token_id + 1, uint32_t(1)));
+    CHECK(!push(PAYER, WAXPAY, "settle"_n, store + 1, token_id, uint32_t(1)));
+
+    // A ledger row under this token id that holds another token is never topped up
+    CHECK(pay(asset(101000001, WAX), prefix + "p3"));
+    CHECK(push(WAXPAY, WAXPAY, "acceptorder"_n, prefix + "p3", store, std::string("thanks")));
+    native_access::waxpay_payouts carol_payouts(WAXPAY, carol.value);
+    as_contract(WAXPAY, [&] {
+        carol_payouts.modify(carol_payouts.get(token_id), same_payer, [&](auto& row) {
+            row.token_contract = "other.token"_n;
+        });
+    });
+    CHECK(pay(asset(101000001, WAX), prefix + "p4"));
+    CHECK(!push(WAXPAY, WAXPAY, "acceptorder"_n, prefix + "p4", store, std::string("thanks")));
+    CHECK(push(WAXPAY, WAXPAY, "rejectorder"_n, prefix + "p4"));
+    CHECK(push(PAYER, WAXPAY, "claim"_n, PAYER, uint32_t(5)));
+    CHECK(push(owner, SWL, "setpullmode"_n, owner, false));
+
+    // Unknown tokens and stores that don't accept the token are turned away
+    symbol other = token_symbol(0);
+    CHECK(push(TOKEN, TOKEN, "create"_n, TOKEN, asset(1000000, other)));
+    CHECK(push(TOKEN, TOKEN, "issue"_n, TOKEN, asset(1000000, other), std::string("")));
+    CHECK(push(TOKEN, TOKEN, "transfer"_n, TOKEN, PAYER, asset(1000000, other), std::string("")));
+    CHECK(!pay(asset(1000, other), prefix + "c"));
+    CHECK(!pay(asset(101000001, WAX), "99:c"));
+
+    // Auto-accept settles structured payments on arrival
+    CHECK(push(owner, SWL, "setautoacc"_n, owner, true));
+    CHECK(pay(asset(101000001, WAX), prefix + "d"));
+    CHECK(balance(bob, WAX) == 4 * 33333333);
+    CHECK(!push(PAYER, WAXPAY, "getorder"_n, prefix + "d"));
+
+    // Store stats left under this token id by another token start over
+    as_contract(WAXPAY, [&] {
+        native_access::waxpay_stats stats(WAXPAY, store);
+        stats.modify(stats.get(token_id), same_payer, [&](auto& row) {
+            row.token_contract = "other.token"_n;
+        });
+    });
+    CHECK(pay(asset(101000001, WAX), prefix + "e"));
+    native_access::waxpay_stats stats(WAXPAY, store);
+    const auto& counters = stats.get(token_id);
+    CHECK(counters.token_contract == TOKEN && counters.symbol == WAX);
+    CHECK(counters.order_count == 1 && counters.volume == 101000001 && counters.refunds == 0);
+
+    // A contract twl doesn't list is turned away before the memo is even read
+    const name FAKE = "fake.token"_n;
+    eosio::native::chain::get().create_account(FAKE);
+    bind_action(FAKE, "create"_n, &token::create);
+    bind_action(FAKE, "issue"_n, &token::issue);
+    bind_action(FAKE, "transfer"_n, &token::transfer);
+    CHECK(push(FAKE, FAKE, "create"_n, FAKE, asset(1000000000000000LL, WAX)));
+    CHECK(push(FAKE, FAKE, "issue"_n, FAKE, asset(1000000000000000LL, WAX), std::string("")));
+    CHECK(push(FAKE, FAKE, "transfer"_n, FAKE, PAYER, asset(1000000000000000LL, WAX), std::string("")));
+    CHECK(!push(PAYER, FAKE, "transfer"_n, PAYER, WAXPAY, asset(1000, WAX), std::string("")));
+    CHECK(eosio::native::chain::get().last_error == "Token not whitelisted");
+
+    // The same symbol from another contract settles with that contract's own row
+    CHECK(push(TWL, TWL, "addtoken"_n, FAKE, WAX, std::string(""), uint32_t(500)));
+    waxpay::tokencfg_table tokens(WAXPAY, WAXPAY.value);
+    uint64_t fake_id = tokens.get_index<"bytoken"_n>().get((uint128_t(FAKE.value) << 64) | WAX.raw()).id;
+    CHECK(fake_id != token_id);
+    accept_token(owner, fake_id);
+    int64_t wax_fees = balance("fee.waxpayio"_n, WAX);
+    CHECK(push(PAYER, FAKE, "transfer"_n, PAYER, WAXPAY, asset(101000001, WAX), prefix + "f"));
+    CHECK(push(bob, WAXPAY, "settle"_n, store, fake_id, uint32_t(10)));
+    CHECK(token::get_balance(FAKE, "fee.waxpayio"_n, WAX.code()) == fixed_point::fee_amount(101000001, 500, 0));
+    CHECK(balance("fee.waxpayio"_n, WAX) == wax_fees);
+
+    // rejectorders refunds what it finds and skips the rest; claim pays at most
+    // max_rows tokens per call
+    CHECK(pay(asset(7000, WAX), "r1"));
+    CHECK(push(PAYER, FAKE, "transfer"_n, PAYER, WAXPAY, asset(9000, WAX), std::string("r2")));
+    CHECK(push(WAXPAY, WAXPAY, "rejectorders"_n, std::vector<std::string>{"r1", "r2", "missing"}));
+    CHECK(!push(WAXPAY, WAXPAY, "rejectorder"_n, std::string("r1")));
+    CHECK(push(PAYER, WAXPAY, "getbalances"_n, PAYER));
+    CHECK(result<std::vector<waxpay::balance_info>>().size() == 2);
+    int64_t wax_before = balance(PAYER, WAX);
+    int64_t fake_before = token::get_balance(FAKE, PAYER, WAX.code());
+    CHECK(push(PAYER, WAXPAY, "claim"_n, PAYER, uint32_t(1)));
+    CHECK(push(PAYER, WAXPAY, "getbalances"_n, PAYER));
+    CHECK(result<std::vector<waxpay::balance_info>>().size() == 1);
+    CHECK(push(PAYER, WAXPAY, "claim"_n, PAYER, uint32_t(1)));
+    CHECK(balance(PAYER, WAX) == wax_before + 7000);
+    CHECK(token::get_balance(FAKE, PAYER, WAX.code()) == fake_before + 9000);
+    CHECK(push(PAYER, WAXPAY, "getbalances"_n, PAYER));
+    CHECK(result<std::vector<waxpay::balance_info>>().empty());
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Whitelist changes reaching waxpayio: tokencfg, profiles, the recipient migration
+// and the token sweep
+#include "fixture.hpp"
+
+using namespace waxpay_native;
+
+int main() {
+    deploy();
+    uint64_t token_id = add_token(WAX, 100);
+
+    // twl pushes fee changes into waxpayio's own copy
+    CHECK(push(TWL, TWL, "changesysfee"_n, token_id, uint32_t(250)));
+    CHECK(push(TWL, TWL, "addslippage"_n, token_id, uint32_t(30)));
+    // Fresh table objects each time: multi_index caches the rows it has read
+    auto token_config = [&]() { return waxpay::tokencfg_table(WAXPAY, WAXPAY.value); };
+    CHECK(token_config().get(token_id).system_fee == 250);
+    CHECK(token_config().get(token_id).slippage == 30);
+
+    // swl pushes one profile per (store, token) with the recipients' weights
+    std::vector<name> owners;
+    std::vector<uint64_t> stores;
+    for (uint32_t i = 0; i < 5; i++) {
+        owners.push_back(account("shop", i));
+        stores.push_back(add_store(owners.back(), 3));
+        accept_token(owners.back(), token_id);
+    }
+    auto profile = [&]() { return waxpay::profiles_table(WAXPAY, stores[0]).get(token_id); };
+    CHECK(profile().total_weight == 6);
+    CHECK(push(owners[0], SWL, "rmvrec"_n, owners[0], account("rcpt", 2)));
+    CHECK(profile().total_weight == 3);
+    CHECK(push(owners[0], SWL, "changestate"_n, owners[0], token_id, false));
+    CHECK(!profile().active);
+
+    // Store owners are found through byaccount; others can't touch the store
+    CHECK(!push(owners[1], SWL, "rmvrecs"_n, owners[0]));
+    CHECK(!push(PAYER, SWL, "rmvrecs"_n, PAYER));
+
+    // At most 20 recipients per store
+    for (uint32_t i = 3; i < 20; i++) {
+        CHECK(push(owners[1], SWL, "addrecipient"_n, owners[1], account("rcpt", i), uint32_t(1)));
+    }
+    CHECK(!push(owners[1], SWL, "addrecipient"_n, owners[1], account("rcpt", 20), uint32_t(1)));
+
+    // Recipients from before the weights were widened stay in the old uint8_t table
+    // until moved. Profiles still see them, and rows written since are never cut to a byte.
+    std::vector<name> old_owners;
+    std::vector<uint64_t> old_stores;
+    for (uint32_t i = 0; i < 2; i++) {
+        old_owners.push_back(account("old", i));
+        old_stores.push_back(add_store(old_owners.back(), 0));
+        as_contract(SWL, [&] {
+            native_access::swl_recipients_v1 old_recipients(SWL, old_stores.back());
+            for (uint32_t r = 0; r < 2; r++) {
+                old_recipients.emplace(SWL, [&](auto& row) {
+                    row.recipient = account("rcpt", r);
+                    row.weight = uint8_t(10 + r);
+                });
+            }
+        });
+        accept_token(old_owners.back(), token_id);
+        CHECK(waxpay::profiles_table(WAXPAY, old_stores.back()).get(token_id).total_weight == 21);
+    }
+    name new_owner = account("new", 0);
+    uint64_t new_store = add_store(new_owner, 0);
+    CHECK(push(new_owner, SWL, "addrecipient"_n, new_owner, account("rcpt", 0), uint32_t(300)));
+    CHECK(push(old_owners[0], SWL, "addrecipient"_n, old_owners[0], account("rcpt", 5), uint32_t(256)));
+    CHECK(waxpay::profiles_table(WAXPAY, old_stores[0]).get(token_id).total_weight == 277);
+    for (int pass = 0; pass < 2; pass++) {
+        CHECK(push(SWL, SWL, "migraterecs"_n, uint64_t(0), uint32_t(100)));
+    }
+    auto weight = [&](uint64_t store, name recipient) {
+        return native_access::swl_recipients(SWL, store).get(recipient.value).weight;
+    };
+    CHECK(weight(new_store, account("rcpt", 0)) == 300);
+    CHECK(weight(old_stores[0], account("rcpt", 5)) == 256);
+    CHECK(weight(old_stores[0], account("rcpt", 1)) == 11);
+    CHECK(weight(old_stores[1], account("rcpt", 1)) == 11);
+    for (auto store : old_stores) {
+        native_access::swl_recipients_v1 old_recipients(SWL, store);
+        CHECK(old_recipients.begin() == old_recipients.end());
+    }
+
+    // rmtoken queues the store-side removal; sweeptoken drains it in bounded calls
+    CHECK(push(TWL, TWL, "rmtoken"_n, token_id));
+    auto tokencfg = token_config();
+    CHECK(tokencfg.find(token_id) == tokencfg.end());
+
+    // A token added before the sweep ends gets a fresh id, not the removed token's
+    // profiles under a reused one
+    uint64_t next_id = add_token(token_symbol(0), 100);
+    CHECK(next_id != token_id);
+    waxpay::profiles_table other_profiles(WAXPAY, stores[1]);
+    CHECK(other_profiles.find(next_id) == other_profiles.end());
+    CHECK(!push(owners[0], SWL, "addtoken"_n, owners[0], token_id, uint32_t(0), uint32_t(10000), uint64_t(0)));
+    CHECK(push(PAYER, SWL, "sweeptoken"_n, token_id, uint32_t(2)));
+    CHECK(console().find("Next store id") == 0);
+    CHECK(push(PAYER, SWL, "sweeptoken"_n, token_id, uint32_t(10)));
+    CHECK(console() == "Sweep done");
+    for (auto store : stores) {
+        waxpay::profiles_table store_profiles(WAXPAY, store);
+        CHECK(store_profiles.find(token_id) == store_profiles.end());
+        native_access::swl_tokens store_tokens(SWL, store);
+        CHECK(store_tokens.begin() == store_tokens.end());
+    }
+    return 0;
+}
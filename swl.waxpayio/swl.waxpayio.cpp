@@ -1,6 +1,9 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
+#include <eosio/crypto.hpp>
 #include <string>
+#include <vector>
+#include "../common/fixed_point.hpp"
 
 using namespace eosio;
 
@@ -13,26 +16,33 @@ public:
     struct twl_tokens {
         uint64_t id;
         name contract;
-        symbol symbol;
-        double system_fee;
-        double slippage;
+        eosio::symbol symbol;
+        uint32_t system_fee;    // Basis points
+        uint32_t slippage;      // Basis points
         uint64_t primary_key() const { return id; }
     };
-    using twl_tokens_table = eosio::multi_index<"tokens"_n, twl_tokens>;
+    using twl_tokens_table = eosio::multi_index<"whitelist"_n, twl_tokens>;
+
+    // Recipient entry of a waxpayio settlement profile
+    struct recipient_share {
+        name recipient;
+        uint32_t weight;
+    };
 
     // Action: Add a new store to the whitelist
     [[eosio::action]]
-    void addstore(std::string store_id, std::string store_name, name authenticated_account) {
+    void addstore(const std::string &store_id, const std::string &store_name, name authenticated_account) {
         require_auth(get_self());
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action");
 
         stores_table stores(get_self(), get_self().value);
 
         // Ensure store_id and account aren't already used
-        for (auto itr = stores.begin(); itr != stores.end(); itr++) {
-            check(!(itr->store_id == store_id), "Store already registered");
-            check(!(itr->authenticated_account == authenticated_account), "Account already authenticated with another store");
-        }
+        auto by_store_id = stores.get_index<"bystoreid"_n>();
+        auto by_account = stores.get_index<"byaccount"_n>();
+        auto existing = by_store_id.find(hash_id(store_id));
+        check(existing == by_store_id.end() || existing->store_id != store_id, "Store already registered");
+        check(by_account.find(authenticated_account.value) == by_account.end(), "Account already authenticated with another store");
 
         // Save the new store
         stores.emplace(get_self(), [&](auto &row) {
@@ -45,23 +55,32 @@ public:
 
     // Action: Add a revenue-sharing recipient for the store
     [[eosio::action]]
-    void addrecipient(name user, name recipient, uint8_t weight) {
+    void addrecipient(name user, name recipient, uint32_t weight) {
         require_auth(user);
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
+        check(weight > 0, "Weight must be positive");
 
         // Verify store ownership
         auto user_id = check_authorized(user);
+        upgrade_store(user_id);
         recipients_table recipients(get_self(), user_id);
 
         // Ensure the recipient is not already registered
         auto itr = recipients.find(recipient.value);
         check(itr == recipients.end(), "Recipient already exists");
 
+        // Every order pays each recipient, so keep the list bounded
+        uint32_t count = 0;
+        for (auto rec = recipients.begin(); rec != recipients.end(); rec++)
+            count++;
+        check(count < MAX_RECIPIENTS, "Store already has the maximum number of recipients");
+
         // Add recipient
         recipients.emplace(user, [&](auto &row) {
             row.recipient = recipient;
             row.weight = weight;
         });
+        push_store_profiles(user_id);
     }
 
 #pragma region remove recipients
@@ -73,11 +92,13 @@ public:
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
 
         auto user_id = check_authorized(user);
+        upgrade_store(user_id);
         recipients_table recipients(get_self(), user_id);
         auto itr = recipients.begin();
 
         while (itr != recipients.end())
             itr = recipients.erase(itr);
+        push_store_profiles(user_id);
     }
 
     // Action: Remove a single recipient
@@ -87,25 +108,28 @@ public:
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
 
         auto user_id = check_authorized(user);
+        upgrade_store(user_id);
         recipients_table recipients(get_self(), user_id);
         auto itr = recipients.find(recipient.value);
         check(itr != recipients.end(), "Recipient doesn't exist");
 
         recipients.erase(itr);
+        push_store_profiles(user_id);
     }
 
 #pragma endregion
 
 #pragma region token related
 
-    // Action: Add a token to the store's supported tokens list
+    // Action: Add a token to the store's supported tokens list (slippage in basis points)
     [[eosio::action]]
-    void addtoken(name user, uint64_t id, double min_slippage = 0.00, double max_slippage = 100.00, double usd_value = 0.00) {
+    void addtoken(name user, uint64_t id, uint32_t min_slippage = 0, uint32_t max_slippage = fixed_point::BPS_DENOMINATOR, uint64_t usd_value = 0) {
         require_auth(user);
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
         check(min_slippage <= max_slippage, "min cannot be larger than max");
 
         auto user_id = check_authorized(user);
+        upgrade_store(user_id);
         tokens_table tokens(get_self(), user_id);
 
         // Prevent duplicate
@@ -117,23 +141,30 @@ public:
         auto twl_token = twl_tokens.find(id);
         check(twl_token != twl_tokens.end(), "Token not whitelisted");
 
+        // A reused id must wait until the old token is swept from all stores
+        sweeps_table sweeps(get_self(), get_self().value);
+        check(sweeps.find(id) == sweeps.end(), "Token is still being removed from stores");
+
         // Add the token to the store
-        tokens.emplace(user, [&](auto &row) {
+        auto token = tokens.emplace(user, [&](auto &row) {
             row.id = id;
             row.min_slippage = min_slippage;
             row.max_slippage = max_slippage;
             row.usd_value = usd_value;
         });
+        add_token_store(user, id, user_id);
+        push_profile(user_id, *token);
     }
 
-    // Action: Edit store-supported token
+    // Action: Edit store-supported token (slippage in basis points)
     [[eosio::action]]
-    void edittoken(name user, uint64_t id, double min_slippage = 0.00, double max_slippage = 100.00, double usd_value = 0.00) {
+    void edittoken(name user, uint64_t id, uint32_t min_slippage = 0, uint32_t max_slippage = fixed_point::BPS_DENOMINATOR, uint64_t usd_value = 0) {
         require_auth(user);
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
         check(min_slippage <= max_slippage, "min cannot be larger than max");
 
         auto user_id = check_authorized(user);
+        upgrade_store(user_id);
         tokens_table tokens(get_self(), user_id);
 
         auto itr = tokens.find(id);
@@ -144,6 +175,7 @@ public:
             row.max_slippage = max_slippage;
             row.usd_value = usd_value;
         });
+        push_profile(user_id, *itr);
     }
 
     // Action: Toggle token active/inactive status
@@ -153,6 +185,7 @@ public:
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
 
         auto user_id = check_authorized(user);
+        upgrade_store(user_id);
         tokens_table tokens(get_self(), user_id);
         auto itr = tokens.find(id);
         check(itr != tokens.end(), "Token doesn't exist");
@@ -160,6 +193,7 @@ public:
         tokens.modify(itr, same_payer, [&](auto &row) {
             row.active = active;
         });
+        push_profile(user_id, *itr);
     }
 
     // Action: Remove a specific token from a store
@@ -169,11 +203,14 @@ public:
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
 
         auto user_id = check_authorized(user);
+        upgrade_store(user_id);
         tokens_table tokens(get_self(), user_id);
         auto itr = tokens.find(id);
         check(itr != tokens.end(), "Token doesn't exist");
 
         tokens.erase(itr);
+        remove_token_store(id, user_id);
+        drop_profile(user_id, id);
     }
 
     // Action: Admin force-remove a system token from all stores
@@ -182,85 +219,316 @@ public:
         require_auth(TOKEN_WHITELIST);
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
 
-        stores_table stores(get_self(), get_self().value);
-        for (auto store_itr = stores.begin(); store_itr != stores.end(); store_itr++) {
-            tokens_table tokens(get_self(), store_itr->id);
+        // Only queue the sweep, so twl rmtoken never depends on the store count
+        sweeps_table sweeps(get_self(), get_self().value);
+        if (sweeps.find(id) == sweeps.end()) {
+            sweeps.emplace(get_self(), [&](auto &row) {
+                row.token_id = id;
+            });
+        }
+    }
+
+    // Action: Remove a token queued by rmvsystoken from at most `limit` stores.
+    // Only stores listed in tokenstores are visited, and each visited entry is erased,
+    // so the call resumes on its own. Anyone can push it; call again until it prints "Sweep done".
+    [[eosio::action]]
+    void sweeptoken(uint64_t id, uint32_t limit) {
+        check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
+        check(limit > 0, "Limit must be positive");
+
+        sweeps_table sweeps(get_self(), get_self().value);
+        auto sweep = sweeps.find(id);
+        check(sweep != sweeps.end(), "No sweep queued for this token");
+
+        tokenstores_table token_stores(get_self(), id);
+        auto member = token_stores.begin();
+        for (uint32_t i = 0; i < limit && member != token_stores.end(); i++) {
+            tokens_table tokens(get_self(), member->store_id);
             auto token = tokens.find(id);
-            tokens.erase(token);
+            if (token != tokens.end()) {
+                tokens.erase(token);
+                drop_profile(member->store_id, id);
+            }
+            member = token_stores.erase(member);
         }
+
+        if (member == token_stores.end()) {
+            sweeps.erase(sweep);
+            print("Sweep done");
+            return;
+        }
+        print("Next store id: ", member->store_id);
     }
 
 #pragma endregion
 
-    // Action: Clear all stores and their associated data
+    // Action: Choose whether accepted orders are transferred to recipients right away
+    // or credited to the waxpayio payouts ledger for recipients to withdraw
+    [[eosio::action]]
+    void setpullmode(name user, bool enabled) {
+        require_auth(user);
+        check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
+
+        auto user_id = check_authorized(user);
+        upgrade_store(user_id);
+        set_option(user, user_id, PULL_PAYOUTS, enabled);
+    }
+
+    // Action: Let waxpayio settle payments with a "store_id:system_id" memo as soon as
+    // they arrive, instead of waiting for acceptorder
     [[eosio::action]]
-    void cls() {
+    void setautoacc(name user, bool enabled) {
+        require_auth(user);
+        check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
+
+        auto user_id = check_authorized(user);
+        upgrade_store(user_id);
+        set_option(user, user_id, AUTO_ACCEPT, enabled);
+    }
+
+    // Action: Clear all stores and their associated data, at most `limit` rows per call.
+    // Rows are erased from the front, so calling again resumes until it prints "Clear done".
+    [[eosio::action]]
+    void cls(uint32_t limit) {
         require_auth(get_self());
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
+        check(limit > 0, "Limit must be positive");
 
+        uint32_t erased = 0;
         stores_table stores(get_self(), get_self().value);
         auto itr = stores.begin();
 
-        while (itr != stores.end()) {
-            // Erase all recipients for this store
+        while (itr != stores.end() && erased < limit) {
+            // Erase all recipients for this store, in both layouts
+            recipients_v1_table old_recipients(get_self(), itr->id);
+            auto itr1 = old_recipients.begin();
+            for (; itr1 != old_recipients.end() && erased < limit; erased++)
+                itr1 = old_recipients.erase(itr1);
+
             recipients_table recipients(get_self(), itr->id);
             auto itr2 = recipients.begin();
-            while (itr2 != recipients.end())
+            for (; itr2 != recipients.end() && erased < limit; erased++)
                 itr2 = recipients.erase(itr2);
 
-            // Erase all tokens for this store
+            // Erase all tokens for this store, in both layouts, with their tokenstores entries
+            tokens_v1_table old_tokens(get_self(), itr->id);
+            auto itr3 = old_tokens.begin();
+            for (; itr3 != old_tokens.end() && erased < limit; erased++)
+                itr3 = old_tokens.erase(itr3);
+
             tokens_table tokens(get_self(), itr->id);
-            auto itr3 = tokens.begin();
-            while (itr3 != tokens.end())
-                itr3 = tokens.erase(itr3);
+            auto itr4 = tokens.begin();
+            for (; itr4 != tokens.end() && erased < limit; erased++) {
+                remove_token_store(itr4->id, itr->id);
+                drop_profile(itr->id, itr4->id);
+                itr4 = tokens.erase(itr4);
+            }
+
+            // The store row stays until its scoped rows are gone
+            if (itr1 != old_recipients.end() || itr2 != recipients.end() || itr3 != old_tokens.end() ||
+                itr4 != tokens.end() || erased >= limit)
+                break;
+
+            // Erase the store's options
+            options_table options(get_self(), get_self().value);
+            auto option = options.find(itr->id);
+            if (option != options.end())
+                options.erase(option);
 
             // Erase the store itself
             itr = stores.erase(itr);
+            erased++;
+        }
+
+        // Pending sweeps have nothing left to do once the stores are gone
+        sweeps_table sweeps(get_self(), get_self().value);
+        auto sweep = sweeps.begin();
+        if (itr == stores.end()) {
+            for (; sweep != sweeps.end() && erased < limit; erased++)
+                sweep = sweeps.erase(sweep);
+        }
+
+        if (itr == stores.end() && sweep == sweeps.end()) {
+            print("Clear done");
+        } else {
+            print("Erased rows: ", erased);
         }
     }
 
-    /*
-    // Optional: Migration action for older token table format
+    // Action: Rebuild the account/store_id indexes for stores added before they existed
     [[eosio::action]]
-    void migrate() {
-        require_auth(STORE_WHITELIST);
+    void reindex(uint64_t from_id, uint32_t limit) {
+        require_auth(get_self());
         check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
 
+        // Re-emplacing a row writes its secondary index entries
         stores_table stores(get_self(), get_self().value);
-        for (auto store_itr = stores.begin(); store_itr != stores.end(); store_itr++) {
-            tokenmigrate_table tokenmigrate(get_self(), store_itr->id); // Old table
-            tokens_table tokens(get_self(), store_itr->id);             // New table
-
-            for (auto token_itr = tokenmigrate.begin(); token_itr != tokenmigrate.end();) {
-                tokens.emplace(get_self(), [&](auto &row) {
-                    row.id = token_itr->id;
-                    row.min_slippage = token_itr->min_slippage;
-                    row.max_slippage = token_itr->max_slippage;
-                    row.active = token_itr->active;
-                    row.usd_value = 0.00; // Optional or default
-                });
-                token_itr = tokenmigrate.erase(token_itr);
-            }
+        auto itr = stores.lower_bound(from_id);
+        for (uint32_t i = 0; i < limit && itr != stores.end(); i++) {
+            auto row = *itr;
+            itr = stores.erase(itr);
+            stores.emplace(get_self(), [&](auto &r) { r = row; });
+        }
+        if (itr != stores.end()) {
+            print("Next id: ", itr->id);
+        }
+    }
+
+    // Action: Fill tokenstores for store tokens added before it existed.
+    // Run once after deploying, following the printed next store id until it stops.
+    [[eosio::action]]
+    void indextokens(uint64_t from_store, uint32_t limit) {
+        require_auth(get_self());
+        check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
+
+        stores_table stores(get_self(), get_self().value);
+        auto store_itr = stores.lower_bound(from_store);
+        for (uint32_t i = 0; i < limit && store_itr != stores.end(); i++, store_itr++) {
+            tokens_table tokens(get_self(), store_itr->id);
+            for (auto token_itr = tokens.begin(); token_itr != tokens.end(); token_itr++)
+                add_token_store(get_self(), token_itr->id, store_itr->id);
+        }
+        if (store_itr != stores.end()) {
+            print("Next store id: ", store_itr->id);
+        }
+    }
+
+    // Action: Move recipient rows from the old uint8_t weight table to the uint32_t one.
+    // Run once after deploying, following the printed next store id until it stops.
+    // Store owners' recipient actions move their own store's rows first, and moved
+    // rows are gone from the old table, so stores done either way are skipped.
+    [[eosio::action]]
+    void migraterecs(uint64_t from_store, uint32_t limit) {
+        require_auth(get_self());
+        check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
+
+        stores_table stores(get_self(), get_self().value);
+        auto store_itr = stores.lower_bound(from_store);
+        for (uint32_t i = 0; i < limit && store_itr != stores.end(); i++, store_itr++)
+            upgrade_recipients(store_itr->id);
+        if (store_itr != stores.end()) {
+            print("Next store id: ", store_itr->id);
+        }
+    }
+
+    // Action: Push settlement profiles of store tokens added before waxpayio kept its own copy.
+    // Run once after deploying, following the printed next store id until it stops.
+    [[eosio::action]]
+    void pushprofiles(uint64_t from_store, uint32_t limit) {
+        require_auth(get_self());
+        check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
+
+        stores_table stores(get_self(), get_self().value);
+        auto store_itr = stores.lower_bound(from_store);
+        for (uint32_t i = 0; i < limit && store_itr != stores.end(); i++, store_itr++)
+            push_store_profiles(store_itr->id);
+        if (store_itr != stores.end()) {
+            print("Next store id: ", store_itr->id);
+        }
+    }
+
+    // Action: Move store token rows from the old double slippage/usd_value table to
+    // the basis-point one. Run once after deploying, following the printed next store
+    // id until it stops. Store owners' actions move their own store's rows first, and
+    // moved rows are gone from the old table, so stores done either way are skipped.
+    [[eosio::action]]
+    void migrate(uint64_t from_store, uint32_t limit) {
+        require_auth(get_self());
+        check(get_self() == STORE_WHITELIST, "Only the correct contract can execute this action.");
+
+        stores_table stores(get_self(), get_self().value);
+        auto store_itr = stores.lower_bound(from_store);
+        for (uint32_t i = 0; i < limit && store_itr != stores.end(); i++, store_itr++)
+            upgrade_tokens(store_itr->id);
+        if (store_itr != stores.end()) {
+            print("Next store id: ", store_itr->id);
         }
     }
-    */
 
 private:
+    // The native test harness (native/) reads the private tables
+    friend struct native_access;
+
     // Constant names for authority and table scoping
     const name TOKEN_WHITELIST = "twl.waxpayio"_n;
     const name STORE_WHITELIST = "swl.waxpayio"_n;
+    const name PAYMENT_CONTRACT = "waxpayio"_n;
+
+    // Most recipients a store can split its orders between
+    static constexpr uint32_t MAX_RECIPIENTS = 20;
+
+    // Store option flags
+    static constexpr uint64_t PULL_PAYOUTS = 1;   // Credit the payouts ledger instead of transferring
+    static constexpr uint64_t AUTO_ACCEPT = 2;    // Settle structured-memo payments on arrival
 
     // Internal helper: ensures user is tied to a registered store
     uint64_t check_authorized(name user) {
         stores_table stores(get_self(), get_self().value);
-        auto itr = stores.begin();
-        while (itr != stores.end() && itr->authenticated_account != user) {
-            itr++;
-        }
-        check(itr != stores.end(), "This account isn't authorized to work with a store");
+        auto by_account = stores.get_index<"byaccount"_n>();
+        auto itr = by_account.find(user.value);
+        check(itr != by_account.end(), "This account isn't authorized to work with a store");
         return itr->id;
     }
 
+    // Internal helper: turn a store option flag on or off
+    void set_option(name payer, uint64_t store_id, uint64_t flag, bool enabled) {
+        options_table options(get_self(), get_self().value);
+        auto itr = options.find(store_id);
+        if (itr == options.end()) {
+            options.emplace(payer, [&](auto &row) {
+                row.id = store_id;
+                row.flags = enabled ? flag : 0;
+            });
+        } else {
+            options.modify(itr, same_payer, [&](auto &row) {
+                row.flags = enabled ? (row.flags | flag) : (row.flags & ~flag);
+            });
+        }
+
+        // waxpayio reads the flags from its settlement profiles
+        push_store_profiles(store_id);
+    }
+
+    // Internal helper: option flags of a store
+    uint64_t load_flags(uint64_t store_id) {
+        options_table options(get_self(), get_self().value);
+        auto itr = options.find(store_id);
+        return itr != options.end() ? itr->flags : 0;
+    }
+
+    // Internal helper: tell waxpayio a store no longer takes a token
+    void drop_profile(uint64_t store_id, uint64_t token_id) {
+        action(
+            permission_level{get_self(), "active"_n},
+            PAYMENT_CONTRACT,
+            "rmprofile"_n,
+            std::make_tuple(store_id, token_id)
+        ).send();
+    }
+
+    // Internal helper: record that a store accepts a token
+    void add_token_store(name payer, uint64_t token_id, uint64_t store_id) {
+        tokenstores_table token_stores(get_self(), token_id);
+        if (token_stores.find(store_id) == token_stores.end()) {
+            token_stores.emplace(payer, [&](auto &row) {
+                row.store_id = store_id;
+            });
+        }
+    }
+
+    // Internal helper: drop a store from a token's tokenstores list
+    void remove_token_store(uint64_t token_id, uint64_t store_id) {
+        tokenstores_table token_stores(get_self(), token_id);
+        auto itr = token_stores.find(store_id);
+        if (itr != token_stores.end())
+            token_stores.erase(itr);
+    }
+
+    // Internal helper: hash of a store_id string, used by the bystoreid index
+    static checksum256 hash_id(const std::string& store_id) {
+        return sha256(store_id.data(), store_id.size());
+    }
+
     // === Table Definitions ===
 
     // Store registry
@@ -270,37 +538,154 @@ private:
         std::string store_name;
         name authenticated_account;
         uint64_t primary_key() const { return id; }
+        uint64_t by_account() const { return authenticated_account.value; }
+        checksum256 by_store_id() const { return hash_id(store_id); }
     };
-    using stores_table = multi_index<"stores"_n, stores>;
+    using stores_table = multi_index<"stores"_n, stores,
+        indexed_by<"byaccount"_n, const_mem_fun<stores, uint64_t, &stores::by_account>>,
+        indexed_by<"bystoreid"_n, const_mem_fun<stores, checksum256, &stores::by_store_id>>>;
 
-    // Store-specific revenue recipients
-    struct [[eosio::table]] recipients {
+    // Store-wide options, keyed by store id
+    struct [[eosio::table]] options {
+        uint64_t id;
+        uint64_t flags = 0;   // Store option flags
+        uint64_t primary_key() const { return id; }
+    };
+    using options_table = multi_index<"options"_n, options>;
+
+    // Tokens removed from twl.waxpayio that are still being swept from stores
+    struct [[eosio::table]] sweeps {
+        uint64_t token_id;
+        uint64_t primary_key() const { return token_id; }
+    };
+    using sweeps_table = multi_index<"sweeps"_n, sweeps>;
+
+    // Stores that accept a token, scoped by twl.waxpayio token id
+    struct [[eosio::table]] tokenstores {
+        uint64_t store_id;
+        uint64_t primary_key() const { return store_id; }
+    };
+    using tokenstores_table = multi_index<"tokenstores"_n, tokenstores>;
+
+    // Store-specific revenue recipients. Kept under its own name so it never holds
+    // rows with the old uint8_t weights.
+    struct [[eosio::table("shares")]] recipients {
         name recipient;
-        uint8_t weight;  // Used for split percentage
+        uint32_t weight;  // Used for split percentage
         uint64_t primary_key() const { return recipient.value; }
     };
-    using recipients_table = multi_index<"recipients"_n, recipients>;
+    using recipients_table = multi_index<"shares"_n, recipients>;
 
-    // Store-specific token settings
-    struct [[eosio::table]] tokens {
+    // Old recipients table with uint8_t weights, emptied by upgrade_recipients
+    struct recipients_v1 {
+        name recipient;
+        uint8_t weight;
+        uint64_t primary_key() const { return recipient.value; }
+    };
+    using recipients_v1_table = multi_index<"recipients"_n, recipients_v1>;
+
+    // Store-specific token settings. Kept under its own name so it never holds rows
+    // with the old double values.
+    struct [[eosio::table("storetokens")]] tokens {
         uint64_t id;
-        double min_slippage = 0;
-        double max_slippage = 100;
+        uint32_t min_slippage = 0;                              // Basis points
+        uint32_t max_slippage = fixed_point::BPS_DENOMINATOR;   // Basis points
         bool active = true;
-        double usd_value = 0.00;
+        uint64_t usd_value = 0;                                 // 10^-8 USD
         uint64_t primary_key() const { return id; }
     };
-    using tokens_table = multi_index<"tokens"_n, tokens>;
+    using tokens_table = multi_index<"storetokens"_n, tokens>;
+
+    // Internal helper: move a store's recipients out of the old uint8_t weight table.
+    // A store has rows in one table or the other, never both.
+    void upgrade_recipients(uint64_t store_id) {
+        recipients_v1_table old_recipients(get_self(), store_id);
+        recipients_table recipients(get_self(), store_id);
+        for (auto itr = old_recipients.begin(); itr != old_recipients.end();) {
+            auto old = *itr;
+            itr = old_recipients.erase(itr);
+            recipients.emplace(get_self(), [&](auto &row) {
+                row.recipient = old.recipient;
+                row.weight = old.weight;
+            });
+        }
+    }
 
-    /*
-    // Old format (for migration)
-    struct [[eosio::table]] tokenmigrate {
+    // Internal helper: move a store's token rows out of the old double table.
+    // A store has rows in one table or the other, never both.
+    void upgrade_tokens(uint64_t store_id) {
+        tokens_v1_table old_tokens(get_self(), store_id);
+        tokens_table tokens(get_self(), store_id);
+        for (auto itr = old_tokens.begin(); itr != old_tokens.end();) {
+            auto old = *itr;
+            itr = old_tokens.erase(itr);
+            tokens.emplace(get_self(), [&](auto &row) {
+                row.id = old.id;
+                row.min_slippage = fixed_point::percent_to_bps(old.min_slippage);
+                row.max_slippage = fixed_point::percent_to_bps(old.max_slippage);
+                row.active = old.active;
+                row.usd_value = fixed_point::usd_to_fixed(old.usd_value);
+            });
+        }
+    }
+
+    // Internal helper: bring a store's rows to the current layouts before its owner
+    // changes anything, so owner actions never read or write an old-layout row
+    void upgrade_store(uint64_t store_id) {
+        upgrade_recipients(store_id);
+        upgrade_tokens(store_id);
+    }
+
+    // Internal helper: recipients of a store as sent in settlement profiles, from the
+    // old table for a store whose rows haven't been moved yet
+    std::vector<recipient_share> load_shares(uint64_t store_id) {
+        recipients_table recipients(get_self(), store_id);
+        std::vector<recipient_share> shares;
+        for (auto itr = recipients.begin(); itr != recipients.end(); itr++)
+            shares.push_back({itr->recipient, itr->weight});
+        if (shares.empty()) {
+            recipients_v1_table old_recipients(get_self(), store_id);
+            for (auto itr = old_recipients.begin(); itr != old_recipients.end(); itr++)
+                shares.push_back({itr->recipient, itr->weight});
+        }
+        return shares;
+    }
+
+    // Internal helper: send waxpayio everything it needs to settle one store token,
+    // so acceptorder reads one local row instead of three tables of this contract.
+    // Packed straight from the references, so the shares aren't copied per token.
+    void send_profile(uint64_t store_id, const tokens &token, const std::vector<recipient_share> &shares, uint64_t flags) {
+        action(
+            permission_level{get_self(), "active"_n},
+            PAYMENT_CONTRACT,
+            "setprofile"_n,
+            std::forward_as_tuple(store_id, token.id, token.min_slippage, token.max_slippage, token.active, flags, shares)
+        ).send();
+    }
+
+    // Internal helper: push the profile of one store token
+    void push_profile(uint64_t store_id, const tokens &token) {
+        send_profile(store_id, token, load_shares(store_id), load_flags(store_id));
+    }
+
+    // Internal helper: push the profiles of every token of a store, after a
+    // store-wide change (recipients or options)
+    void push_store_profiles(uint64_t store_id) {
+        auto shares = load_shares(store_id);
+        auto flags = load_flags(store_id);
+        tokens_table tokens(get_self(), store_id);
+        for (auto itr = tokens.begin(); itr != tokens.end(); itr++)
+            send_profile(store_id, *itr, shares, flags);
+    }
+
+    // Old token table with doubles, emptied by upgrade_tokens
+    struct tokens_v1 {
         uint64_t id;
         double min_slippage = 0;
         double max_slippage = 100;
         bool active = true;
-        uint64_t primary_key() const { return id; };
+        double usd_value = 0.00;
+        uint64_t primary_key() const { return id; }
     };
-    using tokenmigrate_table = multi_index<"tokenmigrate"_n, tokenmigrate>;
-    */
+    using tokens_v1_table = multi_index<"tokens"_n, tokens_v1>;
 };
@@ -1,6 +1,8 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
+#include <eosio/singleton.hpp>
 #include <string>
+#include "../common/fixed_point.hpp"
 
 using namespace eosio;
 
@@ -19,19 +21,20 @@ public:
 
     typedef multi_index<"stat"_n, currency_stats> stats_table;
 
-    // Action: Add a token to the whitelist
+    // Action: Add a token to the whitelist (system_fee in basis points)
     [[eosio::action]]
-    void addtoken(name contract, symbol symbol, std::string image_link, double system_fee) {
+    void addtoken(name contract, symbol symbol, const std::string& image_link, uint32_t system_fee) {
         require_auth(get_self());
-        check(system_fee >= 0, "System fee cannot be negative");
+
+        // Tokens still in the old table would clash with new ids and duplicates
+        tokens_v1_table old_tokens(get_self(), get_self().value);
+        check(old_tokens.begin() == old_tokens.end(), "Run migrate before adding tokens");
 
         tokens_table tokens(get_self(), get_self().value);
 
         // Ensure token is not already whitelisted
-        auto existing = std::find_if(tokens.begin(), tokens.end(), [&](const auto& row) {
-            return row.contract == contract && row.symbol == symbol;
-        });
-        check(existing == tokens.end(), "Token contract already whitelisted");
+        auto by_token = tokens.get_index<"bytoken"_n>();
+        check(by_token.find(token_key(contract, symbol)) == by_token.end(), "Token contract already whitelisted");
 
         // Check symbol exists in the token's contract
         stats_table stats(contract, symbol.code().raw());
@@ -39,21 +42,28 @@ public:
         check(symbol == stat.supply.symbol, "Symbol precision mismatch");
 
         // Add to whitelist
-        tokens.emplace(get_self(), [&](auto& row) {
-            row.id = tokens.available_primary_key();
+        uint64_t id = next_token_id(tokens);
+        auto itr = tokens.emplace(get_self(), [&](auto& row) {
+            row.id = id;
             row.contract = contract;
             row.symbol = symbol;
-            row.image_link = image_link;
             row.system_fee = system_fee;
-            row.slippage = 0.0; // default slippage
+            row.slippage = 0; // default slippage
         });
+
+        // Display metadata lives in its own table
+        tokenmeta_table meta(get_self(), get_self().value);
+        meta.emplace(get_self(), [&](auto& row) {
+            row.id = itr->id;
+            row.image_link = image_link;
+        });
+        push_config(*itr);
     }
 
-    // Action: Change system fee for a token
+    // Action: Change system fee for a token (basis points)
     [[eosio::action]]
-    void changesysfee(uint64_t id, double system_fee) {
+    void changesysfee(uint64_t id, uint32_t system_fee) {
         require_auth(get_self());
-        check(system_fee >= 0, "System fee cannot be negative");
 
         tokens_table tokens(get_self(), get_self().value);
         auto itr = tokens.find(id);
@@ -62,18 +72,19 @@ public:
         tokens.modify(itr, same_payer, [&](auto& row) {
             row.system_fee = system_fee;
         });
+        push_config(*itr);
     }
 
     // Action: Change token image URL
     [[eosio::action]]
-    void changeimage(uint64_t id, std::string image_link) {
+    void changeimage(uint64_t id, const std::string& image_link) {
         require_auth(get_self());
 
-        tokens_table tokens(get_self(), get_self().value);
-        auto itr = tokens.find(id);
-        check(itr != tokens.end(), "Token doesn't exist.");
+        tokenmeta_table meta(get_self(), get_self().value);
+        auto itr = meta.find(id);
+        check(itr != meta.end(), "Token doesn't exist.");
 
-        tokens.modify(itr, same_payer, [&](auto& row) {
+        meta.modify(itr, same_payer, [&](auto& row) {
             row.image_link = image_link;
         });
     }
@@ -88,8 +99,10 @@ public:
         check(itr != tokens.end(), "Token not found");
 
         tokens.erase(itr);
+        erase_meta(id);
+        drop_config(id);
 
-        // Notify store whitelist contract
+        // Queue the store-side removal; swl sweeptoken drains it in bounded batches
         action(
             permission_level{get_self(), "active"_n},
             STORE_WHITELIST,
@@ -98,23 +111,35 @@ public:
         ).send();
     }
 
-    // Action: Clear all tokens from whitelist (dev/admin only)
+    // Action: Clear the whitelist, at most `limit` tokens per call (dev/admin only).
+    // Call again until it prints "Clear done".
     [[eosio::action]]
-    void cls() {
+    void cls(uint32_t limit) {
         require_auth(get_self());
+        check(limit > 0, "Limit must be positive");
+
+        uint32_t erased = 0;
+        tokens_v1_table old_tokens(get_self(), get_self().value);
+        auto old_itr = old_tokens.begin();
+        for (; erased < limit && old_itr != old_tokens.end(); erased++)
+            old_itr = old_tokens.erase(old_itr);
 
         tokens_table tokens(get_self(), get_self().value);
         auto itr = tokens.begin();
-        while (itr != tokens.end()) {
+        for (; erased < limit && itr != tokens.end(); erased++) {
+            erase_meta(itr->id);
+            drop_config(itr->id);
             itr = tokens.erase(itr);
         }
+        if (old_itr == old_tokens.end() && itr == tokens.end()) {
+            print("Clear done");
+        }
     }
 
-    // Action: Add or change slippage value for a token
+    // Action: Add or change slippage value for a token (basis points)
     [[eosio::action]]
-    void addslippage(uint64_t id, double slippage) {
+    void addslippage(uint64_t id, uint32_t slippage) {
         require_auth(get_self());
-        check(slippage >= 0, "Slippage cannot be negative");
 
         tokens_table tokens(get_self(), get_self().value);
         auto itr = tokens.find(id);
@@ -123,23 +148,172 @@ public:
         tokens.modify(itr, same_payer, [&](auto& row) {
             row.slippage = slippage;
         });
+        push_config(*itr);
+    }
+
+    // Action: Push fee settings of tokens added before waxpayio kept its own copy.
+    // Run once after migrate, following the printed next id until it stops. Tokens
+    // still in the old table aren't read, so their settings are never pushed unconverted.
+    [[eosio::action]]
+    void pushcfg(uint64_t from_id, uint32_t limit) {
+        require_auth(get_self());
+
+        tokens_table tokens(get_self(), get_self().value);
+        auto itr = tokens.lower_bound(from_id);
+        for (uint32_t i = 0; i < limit && itr != tokens.end(); i++, itr++) {
+            push_config(*itr);
+        }
+        if (itr != tokens.end()) {
+            print("Next id: ", itr->id);
+        }
+    }
+
+    // Action: Rebuild the contract/symbol index of whitelisted tokens
+    [[eosio::action]]
+    void reindex(uint64_t from_id, uint32_t limit) {
+        require_auth(get_self());
+
+        // Re-emplacing a row writes its secondary index entries
+        tokens_table tokens(get_self(), get_self().value);
+        auto itr = tokens.lower_bound(from_id);
+        for (uint32_t i = 0; i < limit && itr != tokens.end(); i++) {
+            auto row = *itr;
+            itr = tokens.erase(itr);
+            tokens.emplace(get_self(), [&](auto& r) { r = row; });
+        }
+        if (itr != tokens.end()) {
+            print("Next id: ", itr->id);
+        }
+    }
+
+    // Action: Move tokens from the old table (double fee/slippage, image_link in the row)
+    // to the basis-point whitelist and tokenmeta tables. Run once after deploying,
+    // following the printed next id until it stops. addtoken is refused until it is done.
+    [[eosio::action]]
+    void migrate(uint64_t from_id, uint32_t limit) {
+        require_auth(get_self());
+
+        tokens_v1_table old_tokens(get_self(), get_self().value);
+        tokens_table tokens(get_self(), get_self().value);
+        tokenmeta_table meta(get_self(), get_self().value);
+        auto itr = old_tokens.lower_bound(from_id);
+        for (uint32_t i = 0; i < limit && itr != old_tokens.end(); i++) {
+            auto old = *itr;
+            itr = old_tokens.erase(itr);
+            tokens.emplace(get_self(), [&](auto& row) {
+                row.id = old.id;
+                row.contract = old.contract;
+                row.symbol = old.symbol;
+                row.system_fee = fixed_point::percent_to_bps(old.system_fee);
+                row.slippage = fixed_point::percent_to_bps(old.slippage);
+            });
+            meta.emplace(get_self(), [&](auto& row) {
+                row.id = old.id;
+                row.image_link = old.image_link;
+            });
+        }
+        if (itr != old_tokens.end()) {
+            print("Next id: ", itr->id);
+        }
     }
 
 private:
+    // The native test harness (native/) reads the private tables
+    friend struct native_access;
+
     const name TOKEN_WHITELIST = "twl.waxpayio"_n;
     const name STORE_WHITELIST = "swl.waxpayio"_n;
+    const name PAYMENT_CONTRACT = "waxpayio"_n;
+
+    // Composite key of a token contract and symbol, used by the bytoken index
+    static uint128_t token_key(name contract, symbol symbol) {
+        return (uint128_t(contract.value) << 64) | symbol.raw();
+    }
+
+    // Token settings read on the payment path. Fixed size: display metadata
+    // goes to tokenmeta so it can grow without touching these rows. Kept under its
+    // own name so it never holds rows in the old double layout.
+    struct [[eosio::table("whitelist")]] tokens {
+        uint64_t id;
+        name contract;
+        eosio::symbol symbol;
+        uint32_t system_fee;    // Basis points
+        uint32_t slippage;      // Basis points
+
+        uint64_t primary_key() const { return id; }
+        uint128_t by_token() const { return token_key(contract, symbol); }
+    };
+
+    using tokens_table = multi_index<"whitelist"_n, tokens,
+        indexed_by<"bytoken"_n, const_mem_fun<tokens, uint128_t, &tokens::by_token>>>;
+
+    // Display metadata of a token, keyed by token id
+    struct [[eosio::table]] tokenmeta {
+        uint64_t id;
+        std::string image_link;
+        uint64_t primary_key() const { return id; }
+    };
+    using tokenmeta_table = multi_index<"tokenmeta"_n, tokenmeta>;
+
+    // Id counter, so the id of a removed token is never handed out again
+    struct [[eosio::table]] state {
+        uint64_t next_id = 0;
+    };
+    using state_singleton = singleton<"state"_n, state>;
+
+    // Take the next token id. swl and waxpayio keep rows keyed by a removed token's
+    // id until swl sweeptoken reaches every store, so a reused id would inherit them.
+    // Deployments from before the counter continue after the highest id in use.
+    uint64_t next_token_id(tokens_table& tokens) {
+        state_singleton counter(get_self(), get_self().value);
+        auto current = counter.get_or_default(state{tokens.available_primary_key()});
+        uint64_t id = current.next_id++;
+        counter.set(current, get_self());
+        return id;
+    }
+
+    // Erase a token's display metadata
+    void erase_meta(uint64_t id) {
+        tokenmeta_table meta(get_self(), get_self().value);
+        auto itr = meta.find(id);
+        if (itr != meta.end()) {
+            meta.erase(itr);
+        }
+    }
+
+    // Send waxpayio the settings it needs to settle orders in this token
+    void push_config(const tokens& token) {
+        action(
+            permission_level{get_self(), "active"_n},
+            PAYMENT_CONTRACT,
+            "settokencfg"_n,
+            std::make_tuple(token.id, token.contract, token.symbol, token.system_fee, token.slippage)
+        ).send();
+    }
+
+    // Tell waxpayio a token is no longer whitelisted
+    void drop_config(uint64_t id) {
+        action(
+            permission_level{get_self(), "active"_n},
+            PAYMENT_CONTRACT,
+            "rmtokencfg"_n,
+            std::make_tuple(id)
+        ).send();
+    }
 
-    // Token metadata stored in the contract
-    struct [[eosio::table]] tokens {
+    // Old token table with double percentages, emptied by migrate
+    struct tokens_v1 {
         uint64_t id;
         name contract;
-        symbol symbol;
+        eosio::symbol symbol;
         std::string image_link;
         double system_fee;
         double slippage;
 
         uint64_t primary_key() const { return id; }
+        uint128_t by_token() const { return token_key(contract, symbol); }
     };
 
-    using tokens_table = multi_index<"tokens"_n, tokens>;
+    using tokens_v1_table = multi_index<"tokens"_n, tokens_v1,
+        indexed_by<"bytoken"_n, const_mem_fun<tokens_v1, uint128_t, &tokens_v1::by_token>>>;
 };
@@ -2,9 +2,14 @@
 #include <eosio/asset.hpp>
 #include <eosio/time.hpp>
 #include <eosio/system.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/singleton.hpp>
 #include <string>
 #include <algorithm>
+#include <map>
+#include <vector>
 #include <eosio/print.hpp>
+#include "../common/fixed_point.hpp"
 
 using namespace eosio;
 
@@ -17,41 +22,99 @@ public:
     // Constructor
     waxpay(name receiver, name code, datastream<const char *> ds) : contract(receiver, code, ds) {};
 
-    // Token struct for whitelist
-    struct tokens
+    // Fee settings of a whitelisted token, pushed by twl.waxpayio
+    struct [[eosio::table]] tokencfg
     {
-        uint64_t id;
+        uint64_t id;             // twl.waxpayio token id
         name contract;           // Token contract (e.g. "eosio.token")
-        symbol symbol;           // Token symbol (e.g. WAX)
-        std::string image_link;  // Optional: token image URL
-        double system_fee;       // System fee percentage
-        double slippage;         // Slippage allowed
+        eosio::symbol symbol;           // Token symbol (e.g. WAX)
+        uint32_t system_fee;     // System fee in basis points
+        uint32_t slippage;       // Slippage allowed in basis points
         uint64_t primary_key() const { return id; }
+        uint128_t by_token() const { return token_key(contract, symbol); }
     };
-    using tokens_table = multi_index<"tokens"_n, tokens>;
+    using tokencfg_table = multi_index<"tokencfg"_n, tokencfg,
+        indexed_by<"bytoken"_n, const_mem_fun<tokencfg, uint128_t, &tokencfg::by_token>>>;
 
-    // Store-specific token support definition
-    struct store_tokens
+    // Recipient share structure for splitting
+    struct recipient_share
     {
-        uint64_t id;
-        double min_slippage = 0;
-        double max_slippage = 100;
-        uint64_t primary_key() const { return id; }
+        name recipient;
+        uint32_t weight; // Weight defines proportional share
     };
-    using store_tokens_table = multi_index<"tokens"_n, store_tokens>;
 
-    // Recipient share structure for splitting
-    struct recipients
+    // Settlement profile of one store token, pushed by swl.waxpayio.
+    // Scoped by store id; holds everything acceptorder needs from the store.
+    struct [[eosio::table]] profiles
+    {
+        uint64_t token_id;                                      // twl.waxpayio token id
+        uint32_t min_slippage = 0;                              // Basis points
+        uint32_t max_slippage = fixed_point::BPS_DENOMINATOR;   // Basis points
+        bool active = true;                                     // Disabled tokens are refunded
+        uint64_t flags = 0;                                     // Store option flags
+        std::vector<recipient_share> recipients;
+        uint64_t total_weight = 0;                              // Sum of recipient weights
+        uint64_t primary_key() const { return token_id; }
+    };
+    using profiles_table = multi_index<"profiles"_n, profiles>;
+
+    // Token and store settings shared by every order of one (store, token) pair
+    struct store_config
+    {
+        uint64_t store_id = 0;
+        bool whitelisted = false;
+        bool supported = false;
+        tokencfg token;
+        uint32_t slippage = 0;      // Clamped slippage in basis points
+        std::vector<recipient_share> recipients;
+        uint64_t total_weight = 0;
+        bool pull_payouts = false;  // Credit the payouts ledger instead of transferring
+        bool auto_accept = false;   // Settle "store_id:system_id" payments in orderpaid
+    };
+
+    // Amounts an accepted order is split into
+    struct order_split
+    {
+        int64_t fee = 0;
+        std::vector<int64_t> amounts; // One per recipient, in store_config order
+    };
+
+    // One recipient's part of a quote
+    struct quote_share
     {
         name recipient;
-        uint8_t weight; // Weight defines proportional share
-        uint64_t primary_key() const { return recipient.value; }
+        asset amount;
+    };
+
+    // Returned by quote: how acceptorder would split an order amount
+    struct quote_result
+    {
+        asset fee;
+        uint32_t slippage;                  // Clamped slippage in basis points
+        std::vector<quote_share> shares;    // In the store's recipient order
+    };
+
+    // Returned by getorder
+    struct order_info
+    {
+        uint64_t scope;             // Store id, or the contract name for legacy orders
+        uint64_t id;
+        name sender;
+        name token_contract;
+        eosio::asset asset;
+        time_point_sec timestamp;
+    };
+
+    // Returned by getbalances: one claimable refund balance
+    struct balance_info
+    {
+        name token_contract;
+        asset balance;
     };
-    using recipients_table = multi_index<"recipients"_n, recipients>;
 
     // Triggered automatically when the contract receives a transfer
     [[eosio::on_notify("*::transfer")]]
-    void orderpaid(name from, name to, asset quantity, std::string memo)
+    void orderpaid(name from, name to, const asset &quantity, const std::string &memo)
     {
         // Only process if the transfer is to this contract and from a different user
         check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can receive tokens.");
@@ -59,19 +122,50 @@ public:
             return;
         }
 
+        // Cheapest rejection first: transfers from unknown token contracts (e.g. airdrop
+        // spam) stop here, before the memo checks and the token index lookup
+        check(is_token_contract(get_first_receiver()), "Token not whitelisted");
+
         // Memo should contain a system identifier
-        check(memo != "", "Memo should contain a unique id.");
+        check(!memo.empty(), "Memo should contain a unique id.");
 
         name token_contract = get_first_receiver(); // Get token contract sending the transfer
 
         // Validate token
         auto token = check_token(token_contract, quantity);
 
+        // A "store_id:system_id" memo is checked against the store right away, so a
+        // payment the store can't take fails here instead of being refunded later.
+        // Stores with auto-accept get it settled without an orders row.
+        uint64_t scope = get_self().value;
+        uint64_t store_id;
+        if (parse_store_memo(memo, store_id)) {
+            scope = store_id;
+            auto config = load_config(store_id, token);
+            check(config.supported, "Store doesn't accept this token");
+
+            // Too small an amount leaves the fee or a recipient share at zero
+            order_split split;
+            std::string error = split_order(quantity, config, split);
+            check(error.empty(), error);
+
+            if (config.auto_accept) {
+                settle_order(config, split, memo);
+                return;
+            }
+        }
+
+        // Reject duplicate ids so accept/reject always resolve to a single row.
+        // The key is hashed once for both the lookup and the new row.
+        uint128_t key = order_key(memo);
+        orders_table orders(get_self(), scope);
+        auto by_system_id = orders.get_index<"bysystemid"_n>();
+        check(by_system_id.find(key) == by_system_id.end(), "Order with this id already exists");
+
         // Store the order
-        orders_table orders(get_self(), get_self().value);
         orders.emplace(get_self(), [&](auto &row) {
             row.id = orders.available_primary_key();
-            row.system_id = memo;
+            row.order_key = key;
             row.token_contract = token_contract;
             row.sender = from;
             row.asset = quantity;
@@ -81,7 +175,7 @@ public:
 
     // Dummy auth function for off-chain validation
     [[eosio::action]]
-    void auth(name user, std::string auth_code)
+    void auth(name user, const std::string &auth_code)
     {
         require_auth(user);
         check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
@@ -89,146 +183,528 @@ public:
 
     // Accept order and distribute funds
     [[eosio::action]]
-    void acceptorder(std::string system_id, uint64_t store_id, std::string memo)
+    void acceptorder(const std::string &system_id, uint64_t store_id, const std::string &memo)
     {
         require_auth(get_self());
         check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
 
-        // Lookup order by system_id
-        orders_table orders(get_self(), get_self().value);
-        auto order = orders.begin();
-        while (order != orders.end() && order->system_id != system_id) {
-            order++;
-        }
-        check(order != orders.end(), "Order not found");
+        // Lookup order by system_id, in the store's scope for structured memos
+        uint64_t scope = order_scope(system_id);
+        check(scope == get_self().value || scope == store_id, "Order was paid to another store");
+        orders_table store_orders(get_self(), scope);
+        orders_table legacy_orders(get_self(), get_self().value);
+        orders_table *orders = &store_orders;
+        auto order = find_pending(orders, legacy_orders, system_id);
+        check(order != orders->end(), "Order not found");
 
-        // Fetch token and validate slippage
+        // Fetch token and the store's settings for it
         auto token = check_token(order->token_contract, order->asset);
-        double slippage = token->slippage;
+        auto config = load_config(store_id, token);
 
-        // Check if store supports the token
-        store_tokens_table store_tokens(STORE_WHITELIST, store_id);
-        auto token_itr = store_tokens.begin();
-        while (token_itr != store_tokens.end() && token_itr->id != token->id) {
-            token_itr++;
-        }
-        if (token_itr == store_tokens.end()) {
-            deny_order(order->sender, order->token_contract, order->asset);
-            orders.erase(order);
+        // Refund if the store doesn't support the token or has it disabled
+        if (!config.supported) {
+            deny_order(store_id, order->sender, order->token_contract, order->asset);
+            orders->erase(order);
             return;
         }
 
-        // Clamp slippage within store's limits
-        slippage = std::max(token_itr->min_slippage, std::min(token_itr->max_slippage, slippage));
+        order_split split;
+        std::string error = split_order(order->asset, config, split);
+        check(error.empty(), error);
 
-        // Load recipients for the store
-        recipients_table recipients(STORE_WHITELIST, store_id);
-        uint8_t total_weight = 0;
-        for (auto rec = recipients.begin(); rec != recipients.end(); rec++) {
-            total_weight += rec->weight;
-        }
+        settle_order(config, split, memo);
+        orders->erase(order);
+    }
 
-        // Calculate proportions
-        double total_percentage = token->system_fee + slippage + 100.0;
-        int64_t order_split_value = order->asset.amount / total_percentage;
-        int64_t dev = order_split_value * token->system_fee;
-        int64_t total = order->asset.amount - dev;
+    // Accept several orders of one store in a single pass
+    [[eosio::action]]
+    void acceptorders(const std::vector<std::string> &system_ids, uint64_t store_id, const std::string &memo)
+    {
+        require_auth(get_self());
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
 
-        // Validate dev fee
-        check(dev > 0,
-              ("System fee calculation error. "
-               "Calculated fee: " +
-               asset(dev, token->symbol).to_string() +
-               ", Order amount: " + order->asset.to_string() +
-               ", Total percentage: " + std::to_string(total_percentage) +
-               ", Split value: " + asset(order_split_value, token->symbol).to_string())
-                  .c_str());
+        orders_table store_orders(get_self(), store_id);
+        orders_table legacy_orders(get_self(), get_self().value);
 
-        // Send system fee to fee account
-        send_tokens(token->contract, FEE_ACCOUNT, asset(dev, token->symbol), "System fee.");
+        // Token and store settings are loaded once per token contract/symbol
+        std::map<std::pair<uint64_t, uint64_t>, store_config> configs;
 
-        // Distribute remaining to recipients by weight
-        int64_t distributed_amount = 0;
-        int64_t total_split_amount = total / total_weight;
+        for (const auto &system_id : system_ids) {
+            uint64_t scope = order_scope(system_id);
+            if (scope != get_self().value && scope != store_id) {
+                order_failed(system_id, "Order was paid to another store");
+                continue;
+            }
 
-        for (auto rec = recipients.begin(); rec != recipients.end(); rec++) {
-            int64_t amount = total_split_amount * rec->weight;
-            distributed_amount += amount;
-            check(amount > 0, "Recipient amount is negative");
-            send_tokens(token->contract, rec->recipient, asset(amount, token->symbol), memo);
-        }
+            orders_table *orders = scope == store_id ? &store_orders : &legacy_orders;
+            auto order = find_pending(orders, legacy_orders, system_id);
+            if (order == orders->end()) {
+                order_failed(system_id, "Order not found");
+                continue;
+            }
 
-        // Handle any leftover due to rounding
-        int64_t remaining = total - distributed_amount;
-        print("Remaining: ", remaining);
-        check(remaining >= 0, "Distribution mismatch: overdrawn balance.");
-        if (remaining > 0) {
-            send_tokens(token->contract, FEE_ACCOUNT, asset(remaining, token->symbol), "Remainder.");
-        }
+            auto key = std::make_pair(order->token_contract.value, order->asset.symbol.raw());
+            auto config = configs.find(key);
+            if (config == configs.end()) {
+                tokencfg token;
+                store_config loaded;
+                if (find_token(order->token_contract, order->asset.symbol, token)) {
+                    loaded = load_config(store_id, token);
+                }
+                config = configs.emplace(key, loaded).first;
+            }
+
+            if (!config->second.whitelisted) {
+                order_failed(system_id, "Token not whitelisted");
+                continue;
+            }
+
+            // Refund if the store doesn't support the token or has it disabled
+            if (!config->second.supported) {
+                deny_order(store_id, order->sender, order->token_contract, order->asset);
+                orders->erase(order);
+                order_failed(system_id, "Token not supported or disabled by the store, order refunded");
+                continue;
+            }
 
-        // Remove processed order
-        orders.erase(order);
+            order_split split;
+            std::string error = split_order(order->asset, config->second, split);
+            if (!error.empty()) {
+                order_failed(system_id, error);
+                continue;
+            }
+
+            settle_order(config->second, split, memo);
+            orders->erase(order);
+        }
     }
 
     // Reject order and refund user
     [[eosio::action]]
-    void rejectorder(std::string system_id)
+    void rejectorder(const std::string &system_id)
     {
         require_auth(get_self());
         check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
 
-        orders_table orders(get_self(), get_self().value);
-        auto order = orders.begin();
-        while (order != orders.end() && order->system_id != system_id) {
-            order++;
-        }
-        check(order != orders.end(), "Order not found");
+        uint64_t scope = order_scope(system_id);
+        orders_table store_orders(get_self(), scope);
+        orders_table legacy_orders(get_self(), get_self().value);
+        orders_table *orders = &store_orders;
+        auto order = find_pending(orders, legacy_orders, system_id);
+        check(order != orders->end(), "Order not found");
 
         // Refund tokens to balance
-        deny_order(order->sender, order->token_contract, order->asset);
-        orders.erase(order);
+        deny_order(scope, order->sender, order->token_contract, order->asset);
+        orders->erase(order);
+    }
+
+    // Reject several orders in a single pass
+    [[eosio::action]]
+    void rejectorders(const std::vector<std::string> &system_ids)
+    {
+        require_auth(get_self());
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+
+        orders_table legacy_orders(get_self(), get_self().value);
+        for (const auto &system_id : system_ids) {
+            uint64_t scope = order_scope(system_id);
+            orders_table store_orders(get_self(), scope);
+            orders_table *orders = &store_orders;
+            auto order = find_pending(orders, legacy_orders, system_id);
+            if (order == orders->end()) {
+                order_failed(system_id, "Order not found");
+                continue;
+            }
+
+            deny_order(scope, order->sender, order->token_contract, order->asset);
+            orders->erase(order);
+        }
+    }
+
+    // Log entry for an order a batch action couldn't process
+    [[eosio::action]]
+    void orderfailed(const std::string &system_id, const std::string &reason)
+    {
+        require_auth(get_self());
     }
 
-    // User can claim their rejected/refunded balances
+    // User can claim their rejected/refunded balances, at most max_rows tokens per call
     [[eosio::action]]
-    void claim(name user)
+    void claim(name user, uint32_t max_rows)
     {
         require_auth(user);
         check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+        check(max_rows > 0, "max_rows must be positive");
 
         balances_table balances(get_self(), user.value);
         auto itr = balances.begin();
-        while (itr != balances.end()) {
+        for (uint32_t i = 0; i < max_rows && itr != balances.end(); i++) {
             send_tokens(itr->token_contract, user, itr->asset, "Balance claim");
             itr = balances.erase(itr);
         }
     }
 
-    // Clear all orders (admin action)
+    // Send an account its accumulated payouts for a token in one transfer.
+    // Anyone can push it (e.g. a store-side bot); funds only go to the ledger owner.
+    [[eosio::action]]
+    void withdraw(name recipient, uint64_t token_id)
+    {
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+
+        check(pay_out(recipient, token_id), "Nothing to withdraw");
+    }
+
+    // Pay out everything accrued for a token: fee.waxpayio first, then the store's
+    // recipients from the saved cursor. Each call visits at most `limit` recipients,
+    // so a large store is drained over several transactions. Anyone can push it.
+    [[eosio::action]]
+    void settle(uint64_t store_id, uint64_t token_id, uint32_t limit)
+    {
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+        check(limit > 0, "Limit must be positive");
+
+        // Only stores that take the token get a cursor, so nobody can fill RAM with them
+        profiles_table profiles(get_self(), store_id);
+        auto profile = profiles.find(token_id);
+        check(profile != profiles.end(), "Store doesn't take this token");
+
+        settlements_table settlements(get_self(), store_id);
+        auto cursor = settlements.find(token_id);
+        uint64_t from = cursor == settlements.end() ? 0 : cursor->next_recipient;
+
+        // Fees of every store, once per pass
+        if (from == 0) {
+            pay_out(FEE_ACCOUNT, token_id);
+        }
+
+        // Recipients come from the store's profile, in swl's (name) order
+        const auto &recipients = profile->recipients;
+        auto itr = std::find_if(recipients.begin(), recipients.end(), [&](const auto &rec) {
+            return rec.recipient.value >= from;
+        });
+        for (uint32_t visited = 0; itr != recipients.end() && visited < limit; itr++, visited++) {
+            pay_out(itr->recipient, token_id);
+        }
+
+        // A finished pass leaves no cursor behind
+        uint64_t next = itr == recipients.end() ? 0 : itr->recipient.value;
+        if (next == 0) {
+            if (cursor != settlements.end()) {
+                settlements.erase(cursor);
+            }
+        } else if (cursor == settlements.end()) {
+            settlements.emplace(get_self(), [&](auto &row) {
+                row.token_id = token_id;
+                row.next_recipient = next;
+                row.last_settled = current_time_point();
+            });
+        } else {
+            settlements.modify(cursor, same_payer, [&](auto &row) {
+                row.next_recipient = next;
+                row.last_settled = current_time_point();
+            });
+        }
+
+        print("Next recipient: ", name(next));
+    }
+
+    // Fee settings of a token, sent inline by twl.waxpayio whenever they change
+    [[eosio::action]]
+    void settokencfg(uint64_t id, name contract, symbol symbol, uint32_t system_fee, uint32_t slippage)
+    {
+        require_auth(TOKEN_WHITELIST);
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+
+        tokencfg_table configs(get_self(), get_self().value);
+        auto itr = configs.find(id);
+        auto set = [&](auto &row) {
+            row.id = id;
+            row.contract = contract;
+            row.symbol = symbol;
+            row.system_fee = system_fee;
+            row.slippage = slippage;
+        };
+        if (itr == configs.end()) {
+            configs.emplace(get_self(), set);
+        } else {
+            configs.modify(itr, same_payer, set);
+        }
+
+        // Keep the sorted contract list orderpaid filters on
+        token_contracts_singleton contracts_list(get_self(), get_self().value);
+        auto list = contracts_list.get_or_default();
+        auto pos = std::lower_bound(list.contracts.begin(), list.contracts.end(), contract);
+        if (pos == list.contracts.end() || *pos != contract) {
+            list.contracts.insert(pos, contract);
+            contracts_list.set(list, get_self());
+        }
+    }
+
+    // Sent inline by twl.waxpayio when a token leaves the whitelist
+    [[eosio::action]]
+    void rmtokencfg(uint64_t id)
+    {
+        require_auth(TOKEN_WHITELIST);
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+
+        tokencfg_table configs(get_self(), get_self().value);
+        auto itr = configs.find(id);
+        if (itr == configs.end()) {
+            return;
+        }
+        name contract = itr->contract;
+        configs.erase(itr);
+
+        // Drop the contract from the filter list once none of its tokens is left
+        auto by_token = configs.get_index<"bytoken"_n>();
+        auto other = by_token.lower_bound(token_key(contract, symbol()));
+        if (other != by_token.end() && other->contract == contract) {
+            return;
+        }
+
+        token_contracts_singleton contracts_list(get_self(), get_self().value);
+        auto list = contracts_list.get_or_default();
+        auto pos = std::lower_bound(list.contracts.begin(), list.contracts.end(), contract);
+        if (pos != list.contracts.end() && *pos == contract) {
+            list.contracts.erase(pos);
+            contracts_list.set(list, get_self());
+        }
+    }
+
+    // Settlement profile of a store token, sent inline by swl.waxpayio whenever the
+    // token settings, recipients or store options change
+    [[eosio::action]]
+    void setprofile(uint64_t store_id, uint64_t token_id, uint32_t min_slippage, uint32_t max_slippage,
+                    bool active, uint64_t flags, std::vector<recipient_share> recipients)
+    {
+        require_auth(STORE_WHITELIST);
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+
+        // Weights are summed here once instead of on every order
+        uint64_t total_weight = 0;
+        for (const auto &rec : recipients) {
+            total_weight += rec.weight;
+        }
+
+        profiles_table profiles(get_self(), store_id);
+        auto itr = profiles.find(token_id);
+        auto set = [&](auto &row) {
+            row.token_id = token_id;
+            row.min_slippage = min_slippage;
+            row.max_slippage = max_slippage;
+            row.active = active;
+            row.flags = flags;
+            row.recipients = recipients;
+            row.total_weight = total_weight;
+        };
+        if (itr == profiles.end()) {
+            profiles.emplace(get_self(), set);
+        } else {
+            profiles.modify(itr, same_payer, set);
+        }
+    }
+
+    // Sent inline by swl.waxpayio when a store stops taking a token
+    [[eosio::action]]
+    void rmprofile(uint64_t store_id, uint64_t token_id)
+    {
+        require_auth(STORE_WHITELIST);
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+
+        profiles_table profiles(get_self(), store_id);
+        auto itr = profiles.find(token_id);
+        if (itr != profiles.end()) {
+            profiles.erase(itr);
+        }
+
+        // An unfinished settle pass can't resume without the profile
+        settlements_table settlements(get_self(), store_id);
+        auto cursor = settlements.find(token_id);
+        if (cursor != settlements.end()) {
+            settlements.erase(cursor);
+        }
+    }
+
+    // Clear pending orders of one scope (a store id, or the contract name for
+    // legacy memos), at most `limit` per call (admin action).
+    // Call again until it prints "Clear done".
     [[eosio::action]]
-    void cls()
+    void cls(uint64_t scope, uint32_t limit)
     {
         require_auth(get_self());
         check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+        check(limit > 0, "Limit must be positive");
 
-        orders_table orders(get_self(), get_self().value);
+        orders_table orders(get_self(), scope);
         auto itr = orders.begin();
-        while (itr != orders.end()) {
+        for (uint32_t i = 0; i < limit && itr != orders.end(); i++) {
             itr = orders.erase(itr);
         }
+        if (itr == orders.end()) {
+            print("Clear done");
+        }
+    }
+
+    // Set how long an order can stay pending before expire refunds it (admin action)
+    [[eosio::action]]
+    void setttl(uint32_t seconds)
+    {
+        require_auth(get_self());
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+        check(seconds > 0, "TTL must be positive");
+
+        settings_singleton settings(get_self(), get_self().value);
+        auto current = settings.get_or_default();
+        current.order_ttl = seconds;
+        settings.set(current, get_self());
+    }
+
+    // Refund orders of one scope that have been pending longer than the TTL, oldest
+    // first and at most `limit` per call. Anyone can push it.
+    [[eosio::action]]
+    void expire(uint64_t scope, uint32_t limit)
+    {
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+        check(limit > 0, "Limit must be positive");
+
+        settings_singleton settings(get_self(), get_self().value);
+        uint32_t ttl = settings.get_or_default().order_ttl;
+        uint32_t now = current_time_point().sec_since_epoch();
+        if (now < ttl) {
+            return;
+        }
+
+        orders_table orders(get_self(), scope);
+        auto by_time = orders.get_index<"bytime"_n>();
+        auto itr = by_time.begin();
+        uint32_t expired = 0;
+        for (; expired < limit && itr != by_time.end() && itr->timestamp.sec_since_epoch() <= now - ttl; expired++) {
+            deny_order(scope, itr->sender, itr->token_contract, itr->asset);
+            itr = by_time.erase(itr);
+        }
+        print("Expired orders: ", expired);
+    }
+
+    // Move one scope's orders from the memo string rows in `orders` to the
+    // fixed-size rows in `pending`, at most `limit` per call (admin action).
+    // Rows are moved from the front, so calling again resumes until it prints
+    // "Migration done"; new orders never go to `orders`, so it always finishes.
+    [[eosio::action]]
+    void migrateords(uint64_t scope, uint32_t limit)
+    {
+        require_auth(get_self());
+        check(get_self() == CONTRACT_ACCOUNT, "Only the correct contract can run this action.");
+        check(limit > 0, "Limit must be positive");
+
+        orders_v1_table old_orders(get_self(), scope);
+        orders_table orders(get_self(), scope);
+        auto itr = old_orders.begin();
+        for (uint32_t i = 0; i < limit && itr != old_orders.end(); i++) {
+            auto old = *itr;
+            itr = old_orders.erase(itr);
+            // Orders paid since the deploy already took ids in `pending`
+            orders.emplace(get_self(), [&](auto &row) {
+                row.id = orders.available_primary_key();
+                row.order_key = order_key(old.system_id);
+                row.sender = old.sender;
+                row.token_contract = old.token_contract;
+                row.asset = old.asset;
+                row.timestamp = old.timestamp;
+            });
+        }
+        if (itr == old_orders.end()) {
+            print("Migration done");
+        }
+    }
+
+    // Read-only: what acceptorder would charge and pay out for `amount` of a
+    // store's token, computed by the same code
+    [[eosio::action, eosio::read_only]]
+    quote_result quote(uint64_t store_id, uint64_t token_id, int64_t amount)
+    {
+        tokencfg_table tokens(get_self(), get_self().value);
+        const auto &token = tokens.get(token_id, "Token not whitelisted");
+        check(amount > 0, "Amount must be positive");
+
+        auto config = load_config(store_id, token);
+        check(config.supported, "Store doesn't accept this token");
+
+        order_split split;
+        std::string error = split_order(asset(amount, token.symbol), config, split);
+        check(error.empty(), error);
+
+        quote_result result{asset(split.fee, token.symbol), config.slippage};
+        for (size_t i = 0; i < split.amounts.size(); i++) {
+            result.shares.push_back({config.recipients[i].recipient, asset(split.amounts[i], token.symbol)});
+        }
+        return result;
+    }
+
+    // Read-only: the pending order paid with memo `system_id`
+    [[eosio::action, eosio::read_only]]
+    order_info getorder(const std::string &system_id)
+    {
+        orders_table store_orders(get_self(), order_scope(system_id));
+        orders_table legacy_orders(get_self(), get_self().value);
+        orders_table *orders = &store_orders;
+        auto order = find_pending(orders, legacy_orders, system_id);
+        check(order != orders->end(), "Order not found");
+
+        return {orders->get_scope(), order->id, order->sender, order->token_contract, order->asset, order->timestamp};
+    }
+
+    // Read-only: the refund balances `user` can claim
+    [[eosio::action, eosio::read_only]]
+    std::vector<balance_info> getbalances(name user)
+    {
+        std::vector<balance_info> result;
+        balances_table balances(get_self(), user.value);
+        for (const auto &row : balances) {
+            result.push_back({row.token_contract, row.asset});
+        }
+        return result;
     }
 
 private:
+    // The native test harness (native/) reads the private tables
+    friend struct native_access;
+
     // Constants used in the contract
     const name TOKEN_WHITELIST = "twl.waxpayio"_n;
     const name STORE_WHITELIST = "swl.waxpayio"_n;
     const name CONTRACT_ACCOUNT = "waxpayio"_n;
     const name FEE_ACCOUNT = "fee.waxpayio"_n;
 
-    // Move tokens to a user’s internal balance
-    void deny_order(name sender, name token_contract, asset quantity)
+    // Store option flags (see swl.waxpayio options)
+    static constexpr uint64_t PULL_PAYOUTS = 1;
+    static constexpr uint64_t AUTO_ACCEPT = 2;
+
+    // Pending orders expire after a week unless setttl says otherwise
+    static constexpr uint32_t DEFAULT_ORDER_TTL = 7 * 24 * 60 * 60;
+
+    // Move tokens to a user’s internal balance, one row per token.
+    // store_id is the order's store, or the legacy orders scope when it isn't known;
+    // refunds are only counted in the stats of a known store.
+    void deny_order(uint64_t store_id, name sender, name token_contract, const asset &quantity)
     {
+        tokencfg token;
+        if (store_id != get_self().value && find_token(token_contract, quantity.symbol, token)) {
+            update_stats(store_id, token, [&](auto &row) {
+                row.refunds += quantity.amount;
+                row.refund_count++;
+            });
+        }
+
         balances_table balances(get_self(), sender.value);
+        auto by_token = balances.get_index<"bytoken"_n>();
+        auto itr = by_token.find(token_key(token_contract, quantity.symbol));
+        if (itr != by_token.end()) {
+            by_token.modify(itr, same_payer, [&](auto &row) {
+                row.asset += quantity;
+            });
+            return;
+        }
+
         balances.emplace(get_self(), [&](auto &row) {
             row.id = balances.available_primary_key();
             row.token_contract = token_contract;
@@ -236,45 +712,383 @@ private:
         });
     }
 
+    // Apply an update to a store's revenue counters for a token. Counters left
+    // under the same id by another token start over instead of adding up.
+    template <typename Update>
+    void update_stats(uint64_t store_id, const tokencfg &token, Update &&update)
+    {
+        stats_table stats(get_self(), store_id);
+        auto itr = stats.find(token.id);
+        auto apply = [&](auto &row) {
+            if (row.token_contract != token.contract || row.symbol != token.symbol) {
+                row = {};
+                row.token_id = token.id;
+                row.token_contract = token.contract;
+                row.symbol = token.symbol;
+            }
+            update(row);
+            row.last_activity = current_time_point();
+        };
+        if (itr == stats.end()) {
+            stats.emplace(get_self(), apply);
+        } else {
+            stats.modify(itr, same_payer, apply);
+        }
+    }
+
+    // Composite key of a token contract and symbol, matches twl's bytoken index
+    static uint128_t token_key(name token_contract, symbol sym)
+    {
+        return (uint128_t(token_contract.value) << 64) | sym.raw();
+    }
+
+    // Look up a whitelisted token; returns false if it isn't whitelisted
+    bool find_token(name token_contract, symbol sym, tokencfg &token)
+    {
+        tokencfg_table configs(get_self(), get_self().value);
+        auto by_token = configs.get_index<"bytoken"_n>();
+        auto itr = by_token.find(token_key(token_contract, sym));
+        if (itr == by_token.end()) {
+            return false;
+        }
+        token = *itr;
+        return true;
+    }
+
+    // Whether any whitelisted token lives in this contract
+    bool is_token_contract(name token_contract)
+    {
+        token_contracts_singleton contracts_list(get_self(), get_self().value);
+        auto list = contracts_list.get_or_default();
+        return std::binary_search(list.contracts.begin(), list.contracts.end(), token_contract);
+    }
+
     // Validate if token is whitelisted
-    tokens_table::const_iterator check_token(name token_contract, asset quantity)
+    tokencfg check_token(name token_contract, const asset &quantity)
+    {
+        tokencfg token;
+        check(find_token(token_contract, quantity.symbol, token), "Token not whitelisted");
+        return token;
+    }
+
+    // Load the store's settings for a whitelisted token
+    store_config load_config(uint64_t store_id, const tokencfg &token)
+    {
+        store_config config;
+        config.store_id = store_id;
+        config.whitelisted = true;
+        config.token = token;
+
+        // Check if store supports the token and has it enabled
+        profiles_table profiles(get_self(), store_id);
+        auto profile = profiles.find(token.id);
+        if (profile == profiles.end() || !profile->active) {
+            return config;
+        }
+        config.supported = true;
+
+        // Clamp slippage within store's limits
+        config.slippage = fixed_point::clamp_bps(token.slippage, profile->min_slippage, profile->max_slippage);
+
+        config.recipients = profile->recipients;
+        config.total_weight = profile->total_weight;
+        config.pull_payouts = (profile->flags & PULL_PAYOUTS) != 0;
+        config.auto_accept = (profile->flags & AUTO_ACCEPT) != 0;
+        return config;
+    }
+
+    // Split an order between the fee account and the recipients.
+    // Returns an error message, or an empty string if the order can be settled.
+    std::string split_order(const asset &quantity, const store_config &config, order_split &split)
+    {
+        const tokencfg &token = config.token;
+        if (config.total_weight == 0) {
+            return "Store has no recipients";
+        }
+
+        // Calculate proportions
+        split.fee = fixed_point::fee_amount(quantity.amount, token.system_fee, config.slippage);
+        int64_t total = quantity.amount - split.fee;
+
+        // Validate dev fee
+        if (split.fee <= 0) {
+            return "System fee calculation error. "
+                   "Calculated fee: " +
+                   asset(split.fee, token.symbol).to_string() +
+                   ", Order amount: " + quantity.to_string() +
+                   ", System fee: " + std::to_string(token.system_fee) + " bps" +
+                   ", Slippage: " + std::to_string(config.slippage) + " bps";
+        }
+
+        // Distribute the rest to recipients by weight, down to the last unit
+        fixed_point::weighted_splitter splitter{total, config.total_weight};
+        for (const auto &rec : config.recipients) {
+            int64_t amount = splitter.next(rec.weight);
+            if (amount <= 0) {
+                return "Order amount too small to split between recipients";
+            }
+            split.amounts.push_back(amount);
+        }
+        return "";
+    }
+
+    // Credit the fee and pay or credit the recipients' shares
+    void settle_order(const store_config &config, const order_split &split, const std::string &memo)
+    {
+        const tokencfg &token = config.token;
+
+        int64_t shares = 0;
+        for (auto amount : split.amounts) {
+            shares += amount;
+        }
+        update_stats(config.store_id, token, [&](auto &row) {
+            row.volume += split.fee + shares;
+            row.fees += split.fee;
+            row.payouts += shares;
+            row.order_count++;
+        });
+
+        // The fee accrues for fee.waxpayio until the next settle
+        credit_payout(FEE_ACCOUNT, token, split.fee);
+
+        // Pull mode: credit the ledger, recipients withdraw or get settled later
+        if (config.pull_payouts) {
+            for (size_t i = 0; i < config.recipients.size(); i++) {
+                credit_payout(config.recipients[i].recipient, token, split.amounts[i]);
+            }
+            return;
+        }
+
+        for (size_t i = 0; i < config.recipients.size(); i++) {
+            send_tokens(token.contract, config.recipients[i].recipient, asset(split.amounts[i], token.symbol), memo);
+        }
+    }
+
+    // Add to an account's payouts ledger balance for a token
+    void credit_payout(name account, const tokencfg &token, int64_t amount)
+    {
+        payouts_table payouts(get_self(), account.value);
+        auto itr = payouts.find(token.id);
+        if (itr != payouts.end()) {
+            // Never add one token's amount to another token's balance under the same id
+            check(itr->token_contract == token.contract && itr->balance.symbol == token.symbol,
+                  "Payouts row belongs to another token, withdraw it first");
+            payouts.modify(itr, same_payer, [&](auto &row) {
+                row.balance.amount += amount;
+            });
+            return;
+        }
+
+        payouts.emplace(get_self(), [&](auto &row) {
+            row.token_id = token.id;
+            row.token_contract = token.contract;
+            row.balance = asset(amount, token.symbol);
+        });
+    }
+
+    // Send an account's payouts ledger balance for a token and free the row.
+    // Returns false when there is nothing accrued.
+    bool pay_out(name account, uint64_t token_id)
+    {
+        payouts_table payouts(get_self(), account.value);
+        auto itr = payouts.find(token_id);
+        if (itr == payouts.end()) {
+            return false;
+        }
+
+        if (itr->balance.amount > 0) {
+            send_tokens(itr->token_contract, account, itr->balance, "Payout.");
+        }
+        payouts.erase(itr);
+        return true;
+    }
+
+    // Orders scope for a system_id: the store id of a "store_id:system_id" memo,
+    // or the contract's own scope for legacy memos
+    uint64_t order_scope(const std::string &system_id)
+    {
+        uint64_t store_id;
+        return parse_store_memo(system_id, store_id) ? store_id : get_self().value;
+    }
+
+    // Parse the store id out of a "store_id:system_id" memo.
+    // Returns false for any other memo format.
+    static bool parse_store_memo(const std::string &memo, uint64_t &store_id)
+    {
+        auto colon = memo.find(':');
+        if (colon == 0 || colon == std::string::npos || colon + 1 == memo.size()) {
+            return false;
+        }
+
+        uint64_t id = 0;
+        for (size_t i = 0; i < colon; i++) {
+            if (memo[i] < '0' || memo[i] > '9') {
+                return false;
+            }
+            uint64_t digit = memo[i] - '0';
+            if (id > (UINT64_MAX - digit) / 10) {
+                return false;
+            }
+            id = id * 10 + digit;
+        }
+        store_id = id;
+        return true;
+    }
+
+    // Report an order a batch action skipped
+    void order_failed(const std::string &system_id, const std::string &reason)
+    {
+        action(permission_level{get_self(), "active"_n}, get_self(), "orderfailed"_n,
+               std::make_tuple(system_id, reason)).send();
+    }
+
+    // Hash of a system_id, the secondary key of orders_v1 rows
+    static checksum256 hash_id(const std::string &system_id)
     {
-        tokens_table tokens(TOKEN_WHITELIST, TOKEN_WHITELIST.value);
-        auto itr = tokens.begin();
-        while (itr != tokens.end() && itr->symbol != quantity.symbol && itr->contract != token_contract) {
-            itr++;
+        return sha256(system_id.data(), system_id.size());
+    }
+
+    // First 128 bits of the sha256 of a system_id, stored in place of the memo.
+    // The memo itself stays readable in the transfer that paid the order.
+    static uint128_t order_key(const std::string &system_id)
+    {
+        auto bytes = hash_id(system_id).extract_as_byte_array();
+        uint128_t key = 0;
+        for (int i = 0; i < 16; i++) {
+            key = (key << 8) | bytes[i];
         }
-        check(itr != tokens.end(), "Token not whitelisted");
-        return itr;
+        return key;
     }
 
-    // Perform inline transfer
-    void send_tokens(name contract, name recipient, asset amount, std::string memo)
+    // Perform inline transfer. The arguments are packed straight from the
+    // references, so the memo isn't copied for every recipient.
+    void send_tokens(name contract, name recipient, const asset &amount, const std::string &memo)
     {
         action(permission_level{get_self(), "active"_n}, contract, "transfer"_n,
-               std::make_tuple(get_self(), recipient, amount, memo)).send();
+               std::forward_as_tuple(get_self(), recipient, amount, memo)).send();
     }
 
-    // Table to store user orders
-    struct [[eosio::table]] orders
+    // Table to store user orders. Fixed size (60 bytes) whatever the memo length.
+    // Kept under its own name so it never holds rows in the memo string layout.
+    struct [[eosio::table("pending")]] orders
+    {
+        uint64_t id;
+        uint128_t order_key;       // order_key() of the memo
+        name sender;
+        name token_contract;
+        eosio::asset asset;
+        time_point_sec timestamp;
+        uint64_t primary_key() const { return id; }
+        uint128_t by_system_id() const { return order_key; }
+        uint64_t by_time() const { return timestamp.sec_since_epoch(); }
+    };
+    using orders_table = multi_index<"pending"_n, orders,
+        indexed_by<"bysystemid"_n, const_mem_fun<orders, uint128_t, &orders::by_system_id>>,
+        indexed_by<"bytime"_n, const_mem_fun<orders, uint64_t, &orders::by_time>>>;
+
+    // Old table with the memo in the row; only migrateords reads it
+    struct orders_v1
     {
         uint64_t id;
-        std::string system_id;     // Unique identifier (from memo)
+        std::string system_id;
         name sender;
         name token_contract;
-        asset asset;
+        eosio::asset asset;
         time_point_sec timestamp;
         uint64_t primary_key() const { return id; }
+        checksum256 by_system_id() const { return hash_id(system_id); }
+        uint64_t by_time() const { return timestamp.sec_since_epoch(); }
     };
-    using orders_table = multi_index<"orders"_n, orders>;
+    using orders_v1_table = multi_index<"orders"_n, orders_v1,
+        indexed_by<"bysystemid"_n, const_mem_fun<orders_v1, checksum256, &orders_v1::by_system_id>>,
+        indexed_by<"bytime"_n, const_mem_fun<orders_v1, uint64_t, &orders_v1::by_time>>>;
+
+    // Find a pending order through the order key index
+    orders_table::const_iterator find_order(const orders_table &orders, const std::string &system_id)
+    {
+        auto by_system_id = orders.get_index<"bysystemid"_n>();
+        auto itr = by_system_id.find(order_key(system_id));
+        if (itr == by_system_id.end()) {
+            return orders.end();
+        }
+        return orders.iterator_to(*itr);
+    }
+
+    // Find a pending order in `*orders`, its store's scope for a structured memo.
+    // Orders paid before they were scoped by store stay in the legacy scope even if
+    // their memo reads "store_id:system_id", so a miss falls back to legacy_orders
+    // and points `orders` at it.
+    orders_table::const_iterator find_pending(orders_table *&orders, orders_table &legacy_orders,
+                                              const std::string &system_id)
+    {
+        auto order = find_order(*orders, system_id);
+        if (order == orders->end() && orders->get_scope() != legacy_orders.get_scope()) {
+            orders = &legacy_orders;
+            order = find_order(legacy_orders, system_id);
+        }
+        return order;
+    }
 
     // Table to store unclaimed balances (e.g. rejected/refunded orders)
     struct [[eosio::table]] balances
     {
         uint64_t id;
         name token_contract;
-        asset asset;
+        eosio::asset asset;
         uint64_t primary_key() const { return id; }
+        uint128_t by_token() const { return token_key(token_contract, asset.symbol); }
+    };
+    using balances_table = multi_index<"balances"_n, balances,
+        indexed_by<"bytoken"_n, const_mem_fun<balances, uint128_t, &balances::by_token>>>;
+
+    // Payouts ledger for stores in pull mode, scoped by recipient
+    struct [[eosio::table]] payouts
+    {
+        uint64_t token_id;      // twl.waxpayio token id
+        name token_contract;
+        asset balance;
+        uint64_t primary_key() const { return token_id; }
+    };
+    using payouts_table = multi_index<"payouts"_n, payouts>;
+
+    // Cursor of an unfinished settle pass per token, scoped by store id
+    struct [[eosio::table]] settlements
+    {
+        uint64_t token_id;          // twl.waxpayio token id
+        uint64_t next_recipient;    // Recipient the next settle starts from
+        time_point_sec last_settled;
+        uint64_t primary_key() const { return token_id; }
+    };
+    using settlements_table = multi_index<"settlements"_n, settlements>;
+
+    // Sorted names of the contracts of all whitelisted tokens, kept with tokencfg
+    struct [[eosio::table]] tokencontrs
+    {
+        std::vector<name> contracts;
+    };
+    using token_contracts_singleton = singleton<"tokencontrs"_n, tokencontrs>;
+
+    // Revenue counters per token, scoped by store id
+    struct [[eosio::table]] stats
+    {
+        uint64_t token_id;              // twl.waxpayio token id
+        name token_contract;
+        eosio::symbol symbol;
+        int64_t volume = 0;             // Gross amount of accepted orders
+        int64_t fees = 0;               // System fees taken from them
+        int64_t payouts = 0;            // Recipients' share of them
+        int64_t refunds = 0;            // Amount of refunded orders
+        uint64_t order_count = 0;       // Accepted orders
+        uint64_t refund_count = 0;      // Refunded orders
+        time_point_sec last_activity;
+        uint64_t primary_key() const { return token_id; }
+    };
+    using stats_table = multi_index<"stats"_n, stats>;
+
+    // Contract-wide settings
+    struct [[eosio::table]] settings
+    {
+        uint32_t order_ttl = DEFAULT_ORDER_TTL;   // Seconds an order may stay pending
     };
-    using balances_table = multi_index<"balances"_n, balances>;
+    using settings_singleton = singleton<"settings"_n, settings>;
 };